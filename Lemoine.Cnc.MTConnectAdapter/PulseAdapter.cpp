@@ -40,24 +40,10 @@ namespace Lemoine
   namespace Cnc
   {
     PulseAdapter::PulseAdapter ()
-      : availability (NULL)
-      , execution (NULL)
-      , mode (NULL)
-      , programName (NULL)
-      , x (NULL)
-      , y (NULL)
-      , z (NULL)
-      , u (NULL)
-      , v (NULL)
-      , w (NULL)
-      , a (NULL)
-      , b (NULL)
-      , c (NULL)
-      , feedrate (NULL)
-      , spindleLoad (NULL)
-      , spindleSpeed (NULL)
-      , feedrateOverride (NULL)
-      , spindleSpeedOverride (NULL)
+      : device (new PulseDevice (*mCore))
+      , pending (new PulseData ())
+      , programNameValue (nullptr)
+      , programNameSet (false)
     {
       log = LogManager::GetLogger (String::Format ("{0}.{1}",
         PulseAdapter::typeid->FullName,
@@ -66,62 +52,21 @@ namespace Lemoine
 
     PulseAdapter::!PulseAdapter ()
     {
-      if (NULL != availability) {
-        delete availability;
+      if (NULL != device) {
+        delete device;
+        device = NULL;
       }
-      if (NULL != execution) {
-        delete execution;
-      }
-      if (NULL != mode) {
-        delete mode;
-      }
-      if (NULL != programName) {
-        delete programName;
-      }
-      if (NULL != x) {
-        delete x;
-      }
-      if (NULL != y) {
-        delete y;
-      }
-      if (NULL != z) {
-        delete z;
-      }
-      if (NULL != u) {
-        delete u;
-      }
-      if (NULL != v) {
-        delete v;
-      }
-      if (NULL != w) {
-        delete w;
-      }
-      if (NULL != a) {
-        delete a;
-      }
-      if (NULL != b) {
-        delete b;
-      }
-      if (NULL != c) {
-        delete c;
-      }
-      if (NULL != feedrate) {
-        delete feedrate;
-      }
-      if (NULL != spindleLoad) {
-        delete spindleLoad;
-      }
-      if (NULL != spindleSpeed) {
-        delete spindleSpeed;
-      }
-      if (NULL != feedrateOverride) {
-        delete feedrateOverride;
-      }
-      if (NULL != spindleSpeedOverride) {
-        delete spindleSpeedOverride;
+      if (NULL != pending) {
+        delete pending;
+        pending = NULL;
       }
     }
 
+    void PulseAdapter::commit ()
+    {
+      device->apply (*pending);
+    }
+
     String^ PulseAdapter::ToString ()
     {
       return String::Format ("CNC module {0}.{1} [{2}]",
@@ -132,15 +77,12 @@ namespace Lemoine
 
     void PulseAdapter::Available::set (bool value)
     {
-      if (NULL == availability) {
-        availability = new Availability ("avail");
-        addDatum (*availability);
-      }
       if (true == value) {
-        availability->available ();
+        pending->mSet |= PULSE_AVAILABLE;
       }
       else {
-        availability->unavailable ();
+        commit ();
+        device->setAvailable (false);
       }
     }
 
@@ -159,7 +101,9 @@ namespace Lemoine
     void PulseAdapter::Error::set (bool value)
     {
       if (true == value) {
+        commit ();
         this->unavailable ();
+        programNameSet = false;
       }
     }
 
@@ -185,183 +129,100 @@ namespace Lemoine
 
     void PulseAdapter::X::set (double value)
     {
-      if (NULL == x) {
-        x = new Sample ("Xact");
-        addDatum (*x);
-      }
-      x->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_X, value);
     }
 
     void PulseAdapter::Y::set (double value)
     {
-      if (NULL == y) {
-        y = new Sample ("Yact");
-        addDatum (*y);
-      }
-      y->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_Y, value);
     }
 
     void PulseAdapter::Z::set (double value)
     {
-      if (NULL == z) {
-        z = new Sample ("Zact");
-        addDatum (*z);
-      }
-      z->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_Z, value);
     }
 
     void PulseAdapter::U::set (double value)
     {
-      if (NULL == u) {
-        u = new Sample ("Uact");
-        addDatum (*u);
-      }
-      u->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_U, value);
     }
 
     void PulseAdapter::V::set (double value)
     {
-      if (NULL == v) {
-        v = new Sample ("Vact");
-        addDatum (*v);
-      }
-      v->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_V, value);
     }
 
     void PulseAdapter::W::set (double value)
     {
-      if (NULL == w) {
-        w = new Sample ("Wact");
-        addDatum (*w);
-      }
-      w->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_W, value);
     }
 
     void PulseAdapter::A::set (double value)
     {
-      if (NULL == a) {
-        a = new Sample ("Apos");
-        addDatum (*a);
-      }
-      a->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_A, value);
     }
 
     void PulseAdapter::B::set (double value)
     {
-      if (NULL == b) {
-        b = new Sample ("Bpos");
-        addDatum (*b);
-      }
-      b->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_B, value);
     }
 
     void PulseAdapter::C::set (double value)
     {
-      if (NULL == c) {
-        c = new Sample ("Cpos");
-        addDatum (*c);
-      }
-      c->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_C, value);
     }
 
     void PulseAdapter::Feedrate::set (double value)
     {
-      if (NULL == feedrate) {
-        feedrate = new Sample ("path_feedrate");
-        addDatum (*feedrate);
-      }
-      feedrate->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_FEEDRATE, value);
     }
 
     void PulseAdapter::SpindleLoad::set (double value)
     {
-      if (NULL == spindleLoad) {
-        spindleLoad = new Sample ("spindle_load");
-        addDatum (*spindleLoad);
-      }
-      spindleLoad->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_SPINDLE_LOAD, value);
     }
 
     void PulseAdapter::SpindleSpeed::set (double value)
     {
-      if (NULL == spindleSpeed) {
-        spindleSpeed = new Sample ("spindle_speed");
-        addDatum (*spindleSpeed);
-      }
-      spindleSpeed->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_SPINDLE_SPEED, value);
     }
 
     void PulseAdapter::Manual::set (bool value)
     {
-      if (NULL == mode) {
-        mode = new ControllerMode ("mode");
-        addDatum (*mode);
-      }
-      if (true == value) {
-        mode->setValue (ControllerMode::eMANUAL);
-      }
-      else {
-        mode->setValue (ControllerMode::eAUTOMATIC);
-      }
-      Available = true;
+      pending->mManual = value;
+      pending->mSet |= PULSE_MANUAL;
     }
 
     void PulseAdapter::FeedrateOverride::set (long value)
     {
-      if (NULL == feedrateOverride) {
-        feedrateOverride = new Sample ("feed_ovr");
-        addDatum (*feedrateOverride);
-      }
-      feedrateOverride->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_FEEDRATE_OVERRIDE, value);
     }
 
     void PulseAdapter::SpindleSpeedOverride::set (long value)
     {
-      if (NULL == spindleSpeedOverride) {
-        spindleSpeedOverride = new Sample ("SspeedOvr");
-        addDatum (*spindleSpeedOverride);
-      }
-      spindleSpeedOverride->setValue (value);
-      Available = true;
+      pending->setSample (ePULSE_SPINDLE_SPEED_OVERRIDE, value);
     }
 
     void PulseAdapter::Running::set (bool value)
     {
-      if (NULL == execution) {
-        execution = new Execution ("execution");
-        addDatum (*execution);
-      }
-      if (true == value) {
-        execution->setValue (Execution::eACTIVE);
-      }
-      else {
-        execution->setValue (Execution::eINTERRUPTED);
-      }
-      Available = true;
+      pending->mRunning = value;
+      pending->mSet |= PULSE_RUNNING;
     }
 
     void PulseAdapter::ProgramName::set (String^ value)
     {
-      if (NULL == programName) {
-        programName = new Event ("program");
-        addDatum (*programName);
+      /* Only convert the name when it changed */
+      if (programNameSet && String::Equals (value, programNameValue)) {
+        pending->mSet |= PULSE_AVAILABLE;
+        return;
       }
+      programNameValue = value;
+      programNameSet = true;
 
-      programName->setValue (Lemoine::Conversion::ConvertToStdString (value).c_str ());
-      Available = true;
+      std::string name = Lemoine::Conversion::ConvertToStdString (value);
+      strncpy (pending->mProgramName, name.c_str (), PULSE_PROGRAM_NAME_LEN);
+      pending->mProgramName[PULSE_PROGRAM_NAME_LEN - 1] = '\0';
+      pending->mSet |= PULSE_PROGRAM_NAME;
     }
   }
 }
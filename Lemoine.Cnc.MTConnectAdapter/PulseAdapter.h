@@ -37,7 +37,7 @@
 #include <Windows.h>
 
 #include "adapter.hpp"
-#include "device_datum.hpp"
+#include "pulse_device.hpp"
 
 using namespace System;
 using namespace System::Collections;
@@ -49,6 +49,9 @@ namespace Lemoine
   {
     /// <summary>
     /// Managed MTConnect adapter for PULSE CNC V2
+    ///
+    /// The property setters only record the values in a native structure,
+    /// that is applied in a single native call when the cycle is finished
     /// </summary>
     public ref class PulseAdapter : public Lemoine::Cnc::ICncModule, public Adapter
     {
@@ -61,24 +64,10 @@ namespace Lemoine
 
       ILog^ log;
 
-      Availability *availability;
-      Execution *execution;
-      ControllerMode *mode;
-      Event *programName;
-      Sample *x;
-      Sample *y;
-      Sample *z;
-      Sample *u;
-      Sample *v;
-      Sample *w;
-      Sample *a;
-      Sample *b;
-      Sample *c;
-      Sample *feedrate;
-      Sample *spindleSpeed;
-      Sample *spindleLoad;
-      Sample *feedrateOverride;
-      Sample *spindleSpeedOverride;
+      PulseDevice *device;    /* The native data values */
+      PulseData *pending;     /* The values set since the last commit */
+      String^ programNameValue; /* The last program name, to skip its conversion */
+      bool programNameSet;
 
     public: // Getters / Setters
       /// <summary>
@@ -382,6 +371,12 @@ namespace Lemoine
 
     public: // Public methods
 
+    protected:
+      /// <summary>
+      /// Apply the values that were set since the last commit
+      /// </summary>
+      virtual void commit () override;
+
     private: // Private methods
     };
   }
@@ -32,158 +32,64 @@
 * SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
 */
 
-#include "internal.hpp"
 #include "adapter.hpp"
-#include "device_datum.hpp"
-#include "logger.hpp"
+#include "StringConversion.h"
 
 namespace Lemoine
 {
   namespace Cnc
   {
     Adapter::Adapter()
-      : mNumDeviceData(0)
-      , mBuffer (new StringBuffer ())
+      : mCore (new AdapterCore ())
     {
-      mServer = 0;
-      mPort = 7878;
-      mHeartbeatFrequency = 10000;
-      mDeviceData = gcnew array <DeviceDatum*> (128);
       log = LogManager::GetLogger (String::Format ("{0}",
         Adapter::typeid->FullName));
     }
 
     Adapter::~Adapter()
     {
-      if (mServer) {
-        delete mServer;
-      }
-      delete mBuffer;
-    }
-
-    /* Add a data value to the list of data values */
-    void Adapter::addDatum(DeviceDatum &aValue)
-    {
-      mDeviceData[mNumDeviceData++] = &aValue;
-      mDeviceData[mNumDeviceData] = 0;
-    }
-
-    void Adapter::Start ()
-    {
-      if (gLogger == NULL) {
-        gLogger = new Logger();
-      }
-
-      if (mServer == NULL) {
-        mServer = new Server(mPort, mHeartbeatFrequency);
-      }
-
-      /* Check if we have any new clients */
-      Client **clients = mServer->connectToClients();
-      bool hasClients = false;
-      if (clients != 0) {
-        hasClients = true;
-        for (int i = 0; clients[i] != 0; i++) {
-          /* If there are any new clients, send them the initial values for all the 
-          * data values */
-          sendInitialData(clients[i]);
-        }
-      }
-
-      /* Read and all data from the clients */
-      mServer->readFromClients();
-
-      /* Don't bother getting data if we don't have anyone to read it */
-      if (mServer->numClients() > 0) {
-        mBuffer->timestamp();
-      }
-      else if (hasClients) {
-        hasClients = false;
-        clientsDisconnected();
-      }
+      delete mCore;
     }
 
-    void Adapter::Finish ()
+    /* Add a data value to the list of data values.
+     * Returns false if a data value with the same name was already added */
+    bool Adapter::addDatum(DeviceDatum &aValue)
     {
-      if (mServer->numClients() > 0) {
-        sendChangedData();
-        mBuffer->reset();
-      }
+      return mCore->addDatum(aValue);
     }
 
-    /* Send a single value to the buffer. */
-    void Adapter::sendDatum(DeviceDatum *aValue)
+    bool Adapter::AddPriorityPeer (String^ address)
     {
-      if (aValue->requiresFlush())
-        sendBuffer();
-      aValue->append(*mBuffer);
-      if (aValue->requiresFlush())
-        sendBuffer();
+      return mCore->addPriorityPeer (Lemoine::Conversion::ConvertToStdString (address).c_str ());
     }
 
-    /* Send the buffer to the clients. Only sends if there is something in the buffer. */
-    void Adapter::sendBuffer()
-    {
-      if (mServer != 0 && mBuffer->length() > 0)
-      {
-        mBuffer->append("\n");
-        mServer->sendToClients(*mBuffer);
-        mBuffer->reset();  
-      }
-    }
-
-    /* Send the initial values to a client */
-    void Adapter::sendInitialData(Client *aClient)
+    void Adapter::Start ()
     {
-      log->Debug ("sendInitialiData /B");
-      mDisableFlush = true;
-      mBuffer->timestamp();
-
-      for (int i = 0; i < mNumDeviceData; i++) {
-        DeviceDatum *value = mDeviceData[i];
-        if (value->hasInitialValue())
-          sendDatum(value);
+      if (mCore->start()) {
+        clientsDisconnected();
       }
-      sendBuffer();
-      mDisableFlush = false;
     }
 
-    /* Send the values that have changed to the clients */
-    void Adapter::sendChangedData()
+    void Adapter::Finish ()
     {
-      for (int i = 0; i < mNumDeviceData; i++)
-      {
-        DeviceDatum *value = mDeviceData[i];
-        if (value->changed())
-          sendDatum(value);
-      }  
-      sendBuffer();
+      commit();
+      mCore->finish();
     }
 
     void Adapter::flush()
     {
-      if (!mDisableFlush)
-      {
-        sendChangedData();
-        mBuffer->reset();
-        mBuffer->timestamp();
-      }
+      mCore->flush();
     }
 
     void Adapter::clientsDisconnected()
     {
       /* Do nothing for now ... */
-      printf("All clients have disconnected\n");
+      log->Info ("clientsDisconnected: all clients have disconnected");
     }
 
     void Adapter::unavailable()
     {
-      for (int i = 0; i < mNumDeviceData; i++)
-      {
-        DeviceDatum *value = mDeviceData[i];
-        value->unavailable();
-      }
-      flush();
+      mCore->unavailable();
     }
   }
 }
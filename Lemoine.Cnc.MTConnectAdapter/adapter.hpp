@@ -35,8 +35,7 @@
 
 #include <Windows.h>
 
-#include "server.hpp"
-#include "string_buffer.hpp"
+#include "adapter_core.hpp"
 
 using namespace System;
 using namespace Lemoine::Core::Log;
@@ -52,7 +51,8 @@ namespace Lemoine
     * to the clients.
     *
     * Subclasses of this class will add the data values and interact with the
-    * vendor specifc API. This class provides all the common functionality.
+    * vendor specifc API. The common functionality is provided by the native
+    * AdapterCore this class wraps.
     */
     public ref class Adapter abstract
     {
@@ -62,33 +62,75 @@ namespace Lemoine
       /// </summary>
       property int Port
       {
-        int get () { return mPort; }
-        void set (int value) { mPort = value; }
+        int get () { return mCore->getPort (); }
+        void set (int value) { mCore->setPort (value); }
+      }
+
+      /// <summary>
+      /// Make the network I/O in a dedicated thread, so that the heartbeats
+      /// and slow clients do not delay Start/Finish (default: false).
+      /// To set before the first call to Start
+      /// </summary>
+      property bool NetworkThread
+      {
+        bool get () { return mCore->getIoThread (); }
+        void set (bool value) { mCore->setIoThread (value); }
+      }
+
+      /// <summary>
+      /// Number of pending connections the server listens for (default: 64).
+      /// To set before the first call to Start
+      /// </summary>
+      property int ListenBacklog
+      {
+        int get () { return mCore->getBacklog (); }
+        void set (int value) { mCore->setBacklog (value); }
+      }
+
+      /// <summary>
+      /// Number of client slots that are only given to the priority peers
+      /// (default: 0). To set before the first call to Start
+      /// </summary>
+      property int ReservedSlots
+      {
+        int get () { return mCore->getReservedSlots (); }
+        void set (int value) { mCore->setReservedSlots (value); }
+      }
+
+      /// <summary>
+      /// Period in ms the statistics of the cycles are logged with (default: 0, never).
+      /// A client also gets them by sending "* stats"
+      /// </summary>
+      property int StatsInterval
+      {
+        int get () { return (int)mCore->getStatsInterval (); }
+        void set (int value) { mCore->setStatsInterval (value > 0 ? value : 0); }
+      }
+
+      /// <summary>
+      /// Port the metrics of the clients and of the cycles are served on over
+      /// HTTP, in the Prometheus text format, at /metrics (default: -1, none).
+      /// To set before the first call to Start
+      /// </summary>
+      property int MetricsPort
+      {
+        int get () { return mCore->getMetricsPort (); }
+        void set (int value) { mCore->setMetricsPort (value); }
       }
 
     private: // Members
       ILog^ log;
 
     protected:
-      Server *mServer;         /* The socket server */
-      StringBuffer *mBuffer;    /* A string buffer to hold the string we write to the streams */
-      array <DeviceDatum*>^ mDeviceData;/* A 0 terminated array of data value objects */
-      int mNumDeviceData;     /* The number of data values */
-      int mPort;              /* The server port we bind to */
-      bool mDisableFlush;     /* Used for initial data collection */
-      int mHeartbeatFrequency; /* The frequency (ms) to heartbeat
-                               * server. Responds to Ping. Default 10 sec */
+      AdapterCore *mCore;     /* The native adapter */
 
     protected:
-      void addDatum(DeviceDatum &aValue);
+      bool addDatum(DeviceDatum &aValue);
 
-      /* Internal buffer sending methods */
-      void sendBuffer();
-      void sendDatum(DeviceDatum *aValue);
-      virtual void sendInitialData(Client *aClient);
-      virtual void sendChangedData();
       virtual void flush();
       virtual void unavailable();
+      /* Apply the values that were set during the cycle, before Finish sends them */
+      virtual void commit() { }
 
     public:
       Adapter();
@@ -104,6 +146,12 @@ namespace Lemoine
       /// </summary>
       void Finish ();
 
+      /// <summary>
+      /// Add a peer (IPv4 address) that can take the reserved slots.
+      /// To call before the first call to Start
+      /// </summary>
+      bool AddPriorityPeer (String^ address);
+
       /* Overload this method to handle situation when all clients disconnect */
       virtual void clientsDisconnected();
     };
@@ -0,0 +1,493 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "adapter_core.hpp"
+#include "server.hpp"
+#include "client.hpp"
+#include "io_thread.hpp"
+#include "frame.hpp"
+#include "string_buffer.hpp"
+#include "device_datum.hpp"
+#include "datum_registry.hpp"
+#include "adapter_host.hpp"
+#include "timer_wheel.hpp"
+#include "histogram.hpp"
+#include "timestamp.hpp"
+#include "logger.hpp"
+
+AdapterCore::AdapterCore(int aPort, int aHeartbeatFrequency)
+  : mServer(0)
+  , mIoThread(0)
+  , mHost(0)
+  , mChannel(0)
+  , mBuffer(new StringBuffer())
+  , mSnapshotBuffer(new StringBuffer())
+  , mSnapshot(0)
+  , mDeviceData(new DatumRegistry())
+  , mChanges(new ChangeList())
+  , mTimers(new TimerWheel())
+  , mPort(aPort)
+  , mDisableFlush(false)
+  , mHasClients(false)
+  , mEpoll(false)
+  , mUseIoThread(false)
+  , mMaxClientQueue(DEFAULT_MAX_QUEUE)
+  , mBacklog(DEFAULT_BACKLOG)
+  , mReservedSlots(0)
+  , mMetricsPort(-1)
+  , mHeartbeatFrequency(aHeartbeatFrequency)
+  , mStats(0)
+  , mCycleStart(0)
+  , mCycleChanges(0)
+  , mStatsInterval(0)
+  , mNextStats(0)
+{
+  mDevice[0] = '\0';
+  if (gLogger == NULL) {
+    gLogger = new Logger();
+  }
+}
+
+AdapterCore::~AdapterCore()
+{
+  if (mServer) {
+    /* The shared server belongs to the host */
+    if (mDevice[0] != '\0')
+      mServer->closeChannel(mChannel);
+    else
+      delete mServer;
+  }
+  if (mIoThread && mHost == 0) {
+    mIoThread->stop();
+    delete mIoThread;
+  }
+  delete mBuffer;
+  delete mSnapshotBuffer;
+  delete mTimers;
+  delete mChanges;
+  delete mDeviceData;
+}
+
+void AdapterCore::setMaxClientQueue(size_t aMaxClientQueue)
+{
+  mMaxClientQueue = aMaxClientQueue;
+  if (mServer != 0)
+    mServer->setMaxQueue(aMaxClientQueue);
+}
+
+bool AdapterCore::addPriorityPeer(const char *aAddress)
+{
+  unsigned long address = inet_addr(aAddress);
+  if (address == INADDR_NONE) {
+    gLogger->warning("Invalid priority peer address: %s", aAddress);
+    return false;
+  }
+  mPriorityPeers.push_back(address);
+  return true;
+}
+
+/* Add a data value to the list of data values */
+bool AdapterCore::addDatum(DeviceDatum &aValue)
+{
+  if (!mDeviceData->add(&aValue)) {
+    gLogger->warning("A data value named %s was already added, skip it", aValue.getName());
+    return false;
+  }
+  if (mDevice[0] != '\0')
+    aValue.setDevice(mDevice);
+  aValue.setChangeList(mChanges);
+  if (mStats != 0)
+    mStats->mDataValues = mDeviceData->size();
+  return true;
+}
+
+/* Prefix the names of the data values with the device */
+void AdapterCore::setDevice(const char *aDevice)
+{
+  strncpy(mDevice, aDevice, DEVICE_NAME_LEN);
+  mDevice[DEVICE_NAME_LEN - 1] = '\0';
+  int count = mDeviceData->size();
+  for (int i = 0; i < count; i++)
+    mDeviceData->at(i)->setDevice(mDevice);
+}
+
+int AdapterCore::numDeviceData()
+{
+  return mDeviceData->size();
+}
+
+int AdapterCore::getMetricsPort()
+{
+  return mServer != 0 ? mServer->getMetricsPort() : mMetricsPort;
+}
+
+DeviceDatum *AdapterCore::getDatum(int aIndex)
+{
+  return mDeviceData->at(aIndex);
+}
+
+DeviceDatum *AdapterCore::getDatum(const char *aName)
+{
+  return mDeviceData->find(aName);
+}
+
+bool AdapterCore::start()
+{
+  mCycleStart = getMonotonicNanoseconds();
+  if (mServer == NULL) {
+    Poller::EMode mode = mEpoll ? Poller::eEPOLL : Poller::eSELECT;
+    ServerSettings settings;
+    settings.mBacklog = mBacklog;
+    settings.mReservedSlots = mReservedSlots;
+    settings.mPriorityPeers = mPriorityPeers;
+    settings.mMetricsPort = mMetricsPort;
+    if (mUseIoThread && mIoThread == 0) {
+      mIoThread = new IoThread(mode);
+      if (!mIoThread->start()) {
+        delete mIoThread;
+        mIoThread = 0;
+      }
+    }
+    if (mIoThread != 0)
+      mServer = new Server(mPort, mHeartbeatFrequency, mIoThread, settings);
+    else
+      mServer = new Server(mPort, mHeartbeatFrequency, mode, settings);
+    mServer->setMaxQueue(mMaxClientQueue);
+    mPort = mServer->getPort();
+  }
+  if (mStats == 0) {
+    mStats = mServer->getStats(mChannel);
+    mStats->mDataValues = mDeviceData->size();
+  }
+
+  /* Accept the new clients and read from the clients, unless the I/O thread does it */
+  if (mIoThread == 0)
+    mServer->process();
+
+  /* If there are any new clients, send them the initial values for all the 
+   * data values */
+  ClientId client;
+  bool newClients = false;
+  while (mServer->nextNewClient(client, mChannel)) {
+    sendInitialData(client);
+    newClients = true;
+  }
+  if (mSnapshot != 0) {
+    mSnapshot->release();
+    mSnapshot = 0;
+  }
+
+  /* Without clients in the previous cycle, all the clients just got the
+   * current values: the pending changes were sent */
+  if (newClients && !mHasClients) {
+    DeviceDatum *value;
+    while ((value = mChanges->pop()) != 0)
+      value->reset();
+  }
+
+  /* Don't bother getting data if we don't have anyone to read it */
+  if (mServer->numClients() > 0) {
+    mHasClients = true;
+    mBuffer->timestamp();
+  }
+  else if (mHasClients) {
+    mHasClients = false;
+    return true;
+  }
+
+  return false;
+}
+
+void AdapterCore::finish()
+{
+  if (mServer != 0 && mServer->numClients() > 0) {
+    sendChangedData();
+    mBuffer->reset();
+  }
+
+  if (mStats != 0 && mCycleStart != 0) {
+    unsigned long long now = getMonotonicNanoseconds();
+    mStats->record(CycleStats::eCYCLE_TIME, now - mCycleStart);
+    mStats->mSuppressedChanges.fetch_add(mChanges->takeSuppressed(), std::memory_order_relaxed);
+    gProcessStats.mCycles.fetch_add(1, std::memory_order_relaxed);
+    mCycleStart = 0;
+    if (mStatsInterval > 0)
+      logStats(now);
+  }
+}
+
+/* Log the statistics once their period elapsed */
+void AdapterCore::logStats(unsigned long long aNow)
+{
+  if (aNow < mNextStats)
+    return;
+  if (mNextStats != 0) {
+    char line[256];
+    for (int m = 0; m < CycleStats::eNUM_METRICS; m++) {
+      mStats->format((CycleStats::EMetric) m, line, sizeof(line));
+      gLogger->info("Statistics %s%s%s", mDevice, mDevice[0] != '\0' ? ":" : "", line);
+    }
+  }
+  mNextStats = aNow + mStatsInterval * 1000000ULL;
+}
+
+/* Send a single value to the buffer. */
+void AdapterCore::sendDatum(DeviceDatum *aValue)
+{
+  mCycleChanges++;
+  if (aValue->requiresFlush())
+    endLine();
+  aValue->append(*mBuffer);
+  if (aValue->requiresFlush())
+    endLine();
+}
+
+/* End the current line of the buffer, if it is not empty */
+void AdapterCore::endLine()
+{
+  if (mBuffer->lineLength() > 0)
+    mBuffer->newLine();
+}
+
+/* Send the buffer to the clients as a single frame, encoded once for all of them,
+ * or to a single client. Only sends if there is something in the buffer. */
+void AdapterCore::sendBuffer(unsigned int aClientId)
+{
+  endLine();
+  if (mServer != 0 && mBuffer->length() > 0)
+  {
+    Frame *frame = Frame::create(*mBuffer, mBuffer->length());
+    if (frame != 0) {
+      mServer->publish(frame, aClientId, mChannel);
+      frame->release();
+    }
+    mBuffer->reset();  
+  }
+}
+
+/* Send the initial values to a new client. The clients accepted during the
+ * same cycle share the same frame. The frame is published even if it is
+ * empty: it is what makes the client get the next changes */
+void AdapterCore::sendInitialData(unsigned int aClientId)
+{
+  gLogger->debug("sendInitialData /B");
+  if (mSnapshot == 0)
+    mSnapshot = createSnapshot();
+  if (mSnapshot != 0)
+    mServer->publish(mSnapshot, aClientId, mChannel);
+}
+
+/* Encode the current values of all the data values in a frame. Only the
+ * values that changed since they were last encoded are encoded again, the
+ * others are copied. The frame is empty if there is no value yet, 0 if it
+ * could not be allocated */
+Frame *AdapterCore::createSnapshot()
+{
+  mDisableFlush = true;
+  mBuffer->timestamp();
+
+  unsigned long long now = 0;
+  int count = mDeviceData->size();
+  for (int i = 0; i < count; i++) {
+    DeviceDatum *value = mDeviceData->at(i);
+    if (!value->hasInitialValue())
+      continue;
+
+    /* The other clients still have to get the pending change */
+    if (value->mSnapshotStale) {
+      mSnapshotBuffer->reset();
+      value->writeSnapshotTo(*mSnapshotBuffer);
+      value->mSnapshot.assign(mSnapshotBuffer->c_str(), mSnapshotBuffer->length());
+      value->mSnapshotStale = false;
+    }
+    appendSnapshot(value);
+
+    /* Start the maximum silence of the values that were never sent */
+    if (value->mMaxSilence > 0 && !value->mTimer.scheduled()) {
+      if (now == 0)
+        now = getMonotonicMilliseconds();
+      schedule(value, now + value->mMaxSilence);
+    }
+  }
+  endLine();
+
+  Frame *frame = Frame::create(*mBuffer, mBuffer->length());
+  mBuffer->reset();
+  mDisableFlush = false;
+  return frame;
+}
+
+/* Copy the encoded value of a data value to the buffer, each of its lines
+ * after the timestamp */
+void AdapterCore::appendSnapshot(DeviceDatum *aValue)
+{
+  if (aValue->requiresFlush())
+    endLine();
+
+  const char *cp = aValue->mSnapshot.c_str();
+  const char *end = cp + aValue->mSnapshot.length();
+  while (cp < end)
+  {
+    const char *eol = (const char *) memchr(cp, '\n', end - cp);
+    if (eol == 0) {
+      mBuffer->append(cp, end - cp);
+      break;
+    }
+    mBuffer->append(cp, eol - cp);
+    mBuffer->newLine();
+    cp = eol + 1;
+  }
+
+  if (aValue->requiresFlush())
+    endLine();
+}
+
+/* Send the values that have changed to the clients, in the order they changed.
+ * The changes of the values with a minimum interval are held until it expired */
+void AdapterCore::sendChangedData()
+{
+  unsigned long long encodeStart = (mStats != 0) ? getMonotonicNanoseconds() : 0;
+  unsigned long long now = 0;
+  if (!mTimers->empty()) {
+    now = getMonotonicMilliseconds();
+    checkSchedule(now);
+  }
+
+  DeviceDatum *value;
+  while ((value = mChanges->pop()) != 0)
+  {
+    if (!value->changed())
+      continue;
+    if (value->mWindow > 0) {
+      sendWindow(value, now);
+      continue;
+    }
+    if (value->mMinInterval == 0 && value->mMaxSilence == 0) {
+      sendDatum(value);
+      continue;
+    }
+
+    if (now == 0)
+      now = getMonotonicMilliseconds();
+    if (value->mMinInterval > 0 && value->mLastSent != 0 &&
+        now < value->mLastSent + value->mMinInterval) {
+      if (mStats != 0)
+        mStats->mHeldChanges.fetch_add(1, std::memory_order_relaxed);
+      schedule(value, value->mLastSent + value->mMinInterval);
+      continue;
+    }
+    sendDatum(value);
+    value->mLastSent = now;
+    if (value->mMaxSilence > 0)
+      schedule(value, now + value->mMaxSilence);
+  }  
+
+  if (mStats != 0) {
+    endLine();
+    unsigned long long sendStart = getMonotonicNanoseconds();
+    mStats->record(CycleStats::eENCODE_TIME, sendStart - encodeStart);
+    mStats->record(CycleStats::eBYTES, mBuffer->length());
+    mStats->record(CycleStats::eLINES, mBuffer->lines());
+    mStats->record(CycleStats::eCHANGES, mCycleChanges);
+    sendBuffer();
+    mStats->record(CycleStats::eSEND_TIME, getMonotonicNanoseconds() - sendStart);
+  }
+  else
+    sendBuffer();
+  mCycleChanges = 0;
+}
+
+/* Send an aggregated value once its window ended, else hold it until then.
+ * A window starts when the previous one was sent, or with the first value */
+void AdapterCore::sendWindow(DeviceDatum *aValue, unsigned long long &aNow)
+{
+  if (aNow == 0)
+    aNow = getMonotonicMilliseconds();
+  if (aValue->mWindowStart == 0)
+    aValue->mWindowStart = aNow;
+  if (aNow < aValue->mWindowStart + aValue->mWindow) {
+    if (mStats != 0)
+      mStats->mHeldChanges.fetch_add(1, std::memory_order_relaxed);
+    schedule(aValue, aValue->mWindowStart + aValue->mWindow);
+    return;
+  }
+
+  aValue->mWindowDuration = (unsigned int) (aNow - aValue->mWindowStart);
+  sendDatum(aValue);
+  aValue->mWindowStart = aValue->mLastSent = aNow;
+}
+
+/* Set the deadline of a value, when it is checked again */
+void AdapterCore::schedule(DeviceDatum *aValue, unsigned long long aDeadline)
+{
+  mTimers->schedule(&aValue->mTimer, aDeadline);
+}
+
+/* Add to the changes the values whose deadline expired: held changes, and
+ * values that were not sent for their maximum silence */
+void AdapterCore::checkSchedule(unsigned long long aNow)
+{
+  Timer *timer;
+  while ((timer = mTimers->nextExpired(aNow)) != 0)
+  {
+    DeviceDatum *value = (DeviceDatum *) timer->getOwner();
+    if (value->changed())
+      mChanges->push(value);
+    else if (value->mMaxSilence > 0 && value->hasInitialValue() &&
+             aNow >= value->mLastSent + value->mMaxSilence)
+      value->markChanged();
+  }
+}
+
+void AdapterCore::flush()
+{
+  if (!mDisableFlush)
+  {
+    sendChangedData();
+    mBuffer->reset();
+    mBuffer->timestamp();
+  }
+}
+
+void AdapterCore::unavailable()
+{
+  int count = mDeviceData->size();
+  for (int i = 0; i < count; i++)
+  {
+    DeviceDatum *value = mDeviceData->at(i);
+    value->unavailable();
+  }
+  flush();
+}
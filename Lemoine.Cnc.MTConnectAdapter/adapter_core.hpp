@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef ADAPTER_CORE_HPP
+#define ADAPTER_CORE_HPP
+
+#include <stddef.h>
+#include <vector>
+
+/* Forward class definitions */
+class Server;
+class IoThread;
+class StringBuffer;
+class Frame;
+class DeviceDatum;
+class ChangeList;
+class DatumRegistry;
+class AdapterHost;
+class TimerWheel;
+class CycleStats;
+
+const int DEVICE_NAME_LEN = 32;
+
+/*
+ * Native part of the adapter that manages all the data values and writing
+ * them to the clients.
+ *
+ * By default, the network I/O is made by start(). With an I/O thread, start()
+ * and finish() only encode the data and publish it to the I/O thread, that
+ * also answers the heartbeats whatever the polling frequency is.
+ *
+ * An AdapterHost can make the network I/O of many adapters.
+ *
+ * It does not depend on the CLR, so that it can be built and profiled on its
+ * own. The managed adapters are thin wrappers around it.
+ */
+class AdapterCore
+{
+protected:
+  Server *mServer;         /* The socket server */
+  IoThread *mIoThread;     /* The thread that makes the network I/O, if any */
+  AdapterHost *mHost;      /* The host that owns mIoThread, and the shared server if any */
+  int mChannel;            /* The channel the adapter publishes through */
+  char mDevice[DEVICE_NAME_LEN]; /* On a shared server, the prefix of the data value names */
+  StringBuffer *mBuffer;   /* A string buffer to hold the string we write to the streams */
+  StringBuffer *mSnapshotBuffer; /* To encode the current value of a data value */
+  Frame *mSnapshot;        /* The initial data of the clients accepted during this cycle */
+  DatumRegistry *mDeviceData; /* The data values, indexed by name */
+  ChangeList *mChanges;    /* The data values that changed since they were sent */
+  TimerWheel *mTimers;     /* The deadlines of the data values: held change,
+                            * end of window or maximum silence */
+  int mPort;               /* The server port we bind to */
+  bool mDisableFlush;      /* Used for initial data collection */
+  bool mHasClients;        /* Were there some clients during the previous cycle ? */
+  bool mEpoll;             /* Use an edge-triggered epoll event loop instead of select */
+  bool mUseIoThread;       /* Make the network I/O in a dedicated thread */
+  size_t mMaxClientQueue;  /* Maximum number of bytes queued for a slow client */
+  int mBacklog;            /* Pending connections the server listens for */
+  int mReservedSlots;      /* Client slots only given to the priority peers */
+  int mMetricsPort;        /* Port of the Prometheus metrics, -1: none */
+  std::vector<unsigned long> mPriorityPeers; /* IPv4 addresses, network order */
+  int mHeartbeatFrequency; /* The frequency (ms) to heartbeat
+                            * server. Responds to Ping. Default 10 sec */
+  CycleStats *mStats;      /* The statistics of the cycles, kept by the server */
+  unsigned long long mCycleStart; /* When start() was called (ns), 0 if no cycle */
+  unsigned int mCycleChanges; /* Data values sent since the previous send */
+  unsigned int mStatsInterval; /* Period (ms) of the statistics in the log, 0: none */
+  unsigned long long mNextStats; /* When the statistics are logged next (ns) */
+
+protected:
+  /* Internal buffer sending methods */
+  void endLine();
+  void sendBuffer(unsigned int aClientId = 0);
+  void sendDatum(DeviceDatum *aValue);
+  Frame *createSnapshot();
+  void appendSnapshot(DeviceDatum *aValue);
+  virtual void sendInitialData(unsigned int aClientId);
+  virtual void sendChangedData();
+  void schedule(DeviceDatum *aValue, unsigned long long aDeadline);
+  void checkSchedule(unsigned long long aNow);
+  void sendWindow(DeviceDatum *aValue, unsigned long long &aNow);
+  void logStats(unsigned long long aNow);
+  void setDevice(const char *aDevice);
+
+  friend class AdapterHost;
+
+public:
+  AdapterCore(int aPort = 7878, int aHeartbeatFrequency = 10000);
+  virtual ~AdapterCore();
+
+  /* Returns false if a data value with the same name was already added */
+  bool addDatum(DeviceDatum &aValue);
+
+  /* Making everything ready to get some data.
+   * Returns true if all the clients disconnected since the previous cycle */
+  bool start();
+
+  /* Once the data has been gathered, send them */
+  void finish();
+
+  virtual void flush();
+  virtual void unavailable();
+
+  /* Getters / Setters */
+  int getPort() { return mPort; }
+  void setPort(int aPort) { mPort = aPort; }
+  bool getEpoll() { return mEpoll; }
+  void setEpoll(bool aEpoll) { mEpoll = aEpoll; } /* To set before the first start() */
+  bool getIoThread() { return mUseIoThread; }
+  void setIoThread(bool aIoThread) { mUseIoThread = aIoThread; } /* To set before the first start() */
+  size_t getMaxClientQueue() { return mMaxClientQueue; }
+  void setMaxClientQueue(size_t aMaxClientQueue); /* Once exceeded, the client is disconnected */
+  int getBacklog() { return mBacklog; }
+  void setBacklog(int aBacklog) { mBacklog = aBacklog; } /* To set before the first start() */
+  /* The port the metrics are served on over HTTP (-1: none, 0: any), to set
+   * before the first start(). Once started, the port in use, 0 if none */
+  int getMetricsPort();
+  void setMetricsPort(int aPort) { mMetricsPort = aPort; }
+  int getReservedSlots() { return mReservedSlots; }
+  void setReservedSlots(int aSlots) { mReservedSlots = aSlots; } /* To set before the first start() */
+  /* Returns false if the address is not a valid IPv4 address. To call before the first start() */
+  bool addPriorityPeer(const char *aAddress);
+  int numDeviceData();
+  DeviceDatum *getDatum(int aIndex);          /* 0 if out of range */
+  DeviceDatum *getDatum(const char *aName);   /* 0 if unknown */
+  const char *getDevice() { return mDevice; } /* Empty unless on a shared port */
+  /* Log the statistics of the cycles every aInterval ms (0: never). They are
+   * also sent to a client that sends "* stats" */
+  unsigned int getStatsInterval() { return mStatsInterval; }
+  void setStatsInterval(unsigned int aInterval) { mStatsInterval = aInterval; mNextStats = 0; }
+  CycleStats *getStats() { return mStats; }  /* 0 before the first start() */
+  Server *server() { return mServer; }
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "adapter_host.hpp"
+#include "adapter_core.hpp"
+#include "server.hpp"
+#include "io_thread.hpp"
+#include "logger.hpp"
+
+AdapterHost::AdapterHost(bool aEpoll)
+  : mIoThread(0)
+  , mSharedServer(0)
+{
+  if (gLogger == NULL) {
+    gLogger = new Logger();
+  }
+  mIoThread = new IoThread(aEpoll ? Poller::eEPOLL : Poller::eSELECT);
+}
+
+AdapterHost::~AdapterHost()
+{
+  delete mSharedServer;
+  mIoThread->stop();
+  delete mIoThread;
+}
+
+bool AdapterHost::start()
+{
+  if (!mIoThread->start()) {
+    gLogger->error("Failed to start the I/O thread of the adapter host");
+    return false;
+  }
+  return true;
+}
+
+bool AdapterHost::openSharedPort(int aPort, int aHeartbeatFrequency, int aBacklog,
+                                 int aMetricsPort)
+{
+  if (mSharedServer != 0)
+    return false;
+
+  ServerSettings settings;
+  settings.mShared = true;
+  if (aBacklog > 0)
+    settings.mBacklog = aBacklog;
+  settings.mMetricsPort = aMetricsPort;
+  mSharedServer = new Server(aPort, aHeartbeatFrequency, mIoThread, settings);
+  return true;
+}
+
+int AdapterHost::getSharedPort()
+{
+  return mSharedServer != 0 ? mSharedServer->getPort() : 0;
+}
+
+bool AdapterHost::add(AdapterCore &aCore, const char *aDevice)
+{
+  if (aCore.mServer != 0 || aCore.mIoThread != 0) {
+    gLogger->error("An adapter must be added to the host before it starts");
+    return false;
+  }
+
+  if (aDevice != 0)
+  {
+    if (mSharedServer == 0) {
+      gLogger->error("Device %s: the shared port of the host is not open", aDevice);
+      return false;
+    }
+    int channel = mSharedServer->openChannel(aDevice);
+    if (channel < 0)
+      return false;
+    aCore.mServer = mSharedServer;
+    aCore.mChannel = channel;
+    aCore.setDevice(aDevice);
+    aCore.mPort = mSharedServer->getPort();
+  }
+
+  aCore.mHost = this;
+  aCore.mIoThread = mIoThread;
+  return true;
+}
@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef ADAPTER_HOST_HPP
+#define ADAPTER_HOST_HPP
+
+#include <vector>
+
+/* Forward class definitions */
+class AdapterCore;
+class IoThread;
+class Server;
+
+/*
+ * Makes the network I/O of many adapters with a single I/O thread, instead
+ * of a thread or a polling loop per adapter.
+ *
+ * Each adapter keeps its own data values and its acquisition thread, that
+ * calls start() and finish(). Its clients are served by the thread of the
+ * host, either on its own port, or on the shared port of the host. On the
+ * shared port, its data values are named "device:name", so that a single
+ * connection of the agent gets the data of all the devices.
+ *
+ * The adapters are added before their first start(), and deleted before the
+ * host.
+ */
+class AdapterHost
+{
+protected:
+  IoThread *mIoThread;
+  Server *mSharedServer;   /* 0 until openSharedPort() */
+
+public:
+  AdapterHost(bool aEpoll = false);
+  virtual ~AdapterHost();
+
+  /* Start the I/O thread. Returns false if it could not be started */
+  bool start();
+
+  /* Listen on the port shared by the adapters added with a device name, and
+   * serve the metrics of all of them on aMetricsPort (-1: none) */
+  bool openSharedPort(int aPort, int aHeartbeatFrequency = 10000, int aBacklog = 0,
+                      int aMetricsPort = -1);
+  int getSharedPort();
+
+  /* Serve an adapter on its own port, or on the shared port with a device
+   * name. Returns false if the adapter already started, or if the shared
+   * port is not open */
+  bool add(AdapterCore &aCore, const char *aDevice = 0);
+
+  IoThread *getIoThread() { return mIoThread; }
+};
+
+#endif
@@ -0,0 +1,375 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+/*
+ * Benchmark of the native SHDR core.
+ *
+ * It measures:
+ * - serialization: the formatting of the data values into a string buffer,
+ * - fan-out: the sending of one buffer to several connected clients,
+ * - cycle: complete start()/finish() cycles of an adapter with some clients.
+ *
+ * The clients are loopback sockets that are drained by a reader thread.
+ * The producer is paced so that the clients keep up: a benchmark fails,
+ * without any figure, if some clients were disconnected.
+ */
+
+#include "internal.hpp"
+#include "adapter_core.hpp"
+#include "server.hpp"
+#include "frame.hpp"
+#include "string_buffer.hpp"
+#include "device_datum.hpp"
+#include "logger.hpp"
+#include "io_thread.hpp"
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  struct Options
+  {
+    int mItems;      /* Number of data items */
+    int mClients;    /* Number of connected clients */
+    int mIterations; /* Number of iterations of each benchmark */
+    int mChanged;    /* Percentage of data items that change in each cycle */
+    bool mEpoll;     /* Use the epoll event loop */
+    bool mIoThread;  /* Make the network I/O of the cycles in a dedicated thread */
+  };
+
+  typedef std::chrono::steady_clock BenchClock;
+
+  double elapsedNs(BenchClock::time_point aStart)
+  {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+      BenchClock::now() - aStart).count();
+  }
+
+  /* Reader thread that drains the client sockets */
+  class Sink
+  {
+  protected:
+    std::vector<int> mSockets;
+    std::atomic<bool> mStop;
+    std::atomic<unsigned long long> mBytes;
+    std::thread mThread;
+
+    void run()
+    {
+      std::vector<struct pollfd> fds(mSockets.size());
+      for (size_t i = 0; i < mSockets.size(); i++) {
+        fds[i].fd = mSockets[i];
+        fds[i].events = POLLIN;
+      }
+      char buffer[65536];
+      while (!mStop.load()) {
+        if (::poll(&fds[0], fds.size(), 10) <= 0)
+          continue;
+        for (size_t i = 0; i < fds.size(); i++) {
+          if (fds[i].revents & POLLIN) {
+            ssize_t len = ::recv(fds[i].fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (len > 0)
+              mBytes += (unsigned long long) len;
+          }
+        }
+      }
+    }
+
+  public:
+    Sink() : mStop(false), mBytes(0) { }
+    ~Sink()
+    {
+      stop();
+      for (size_t i = 0; i < mSockets.size(); i++)
+        ::close(mSockets[i]);
+    }
+
+    /* Connect a new client to the server on the local loopback */
+    int connect(int aPort)
+    {
+      int s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+      SOCKADDR_IN addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(aPort);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::connect(s, (SOCKADDR *) &addr, sizeof(addr)) != 0) {
+        perror("connect");
+        exit(1);
+      }
+      mSockets.push_back(s);
+      return s;
+    }
+
+    void start() { mThread = std::thread(&Sink::run, this); }
+    void stop()
+    {
+      mStop = true;
+      if (mThread.joinable())
+        mThread.join();
+    }
+    unsigned long long bytes() { return mBytes.load(); }
+  };
+
+  /* Create the data items: 3/4 of samples, the rest are events */
+  void createData(const Options &aOptions, std::vector<std::unique_ptr<DeviceDatum> > &aData)
+  {
+    char name[NAME_LEN];
+    for (int i = 0; i < aOptions.mItems; i++) {
+      snprintf(name, NAME_LEN, "item%d", i);
+      if (i % 4 == 3)
+        aData.push_back(std::unique_ptr<DeviceDatum>(new Event(name)));
+      else
+        aData.push_back(std::unique_ptr<DeviceDatum>(new Sample(name)));
+    }
+  }
+
+  /* Update a data item with a value that depends on the iteration */
+  void update(DeviceDatum *aDatum, int aIndex, int aIteration)
+  {
+    if (aIndex % 4 == 3) {
+      char value[32];
+      snprintf(value, sizeof(value), "O%d", aIteration);
+      static_cast<Event *>(aDatum)->setValue(value);
+    }
+    else
+      static_cast<Sample *>(aDatum)->setValue(aIndex * 10.0 + aIteration * 0.001);
+  }
+
+  void benchSerialization(const Options &aOptions)
+  {
+    std::vector<std::unique_ptr<DeviceDatum> > data;
+    createData(aOptions, data);
+    StringBuffer buffer;
+    buffer.timestamp();
+
+    size_t bytes = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int it = 0; it < aOptions.mIterations; it++) {
+      for (int i = 0; i < aOptions.mItems; i++) {
+        update(data[i].get(), i, it);
+        data[i]->append(buffer);
+      }
+      bytes += buffer.length();
+      buffer.reset();
+    }
+    double ns = elapsedNs(start);
+    double lines = (double) aOptions.mIterations * aOptions.mItems;
+    printf("serialization: %10.1f ns/item %10.1f ns/cycle %8.1f MB/s\n",
+      ns / lines, ns / aOptions.mIterations, bytes / ns * 1000.0);
+  }
+
+  /* The figures are only meaningful if all the clients were served */
+  bool checkClients(const char *aBenchmark, const Options &aOptions, int aClients)
+  {
+    if (aClients == aOptions.mClients)
+      return true;
+    fprintf(stderr, "%s: %d of the %d clients were disconnected, no result\n",
+      aBenchmark, aOptions.mClients - aClients, aOptions.mClients);
+    return false;
+  }
+
+  bool benchFanOut(const Options &aOptions)
+  {
+    std::vector<std::unique_ptr<DeviceDatum> > data;
+    createData(aOptions, data);
+    StringBuffer buffer;
+    buffer.timestamp();
+    for (int i = 0; i < aOptions.mItems; i++) {
+      update(data[i].get(), i, 0);
+      data[i]->append(buffer);
+    }
+    buffer.newLine();
+    Frame *frame = Frame::create(buffer, buffer.length());
+
+    Server server(0, 10000, aOptions.mEpoll ? Poller::eEPOLL : Poller::eSELECT);
+    Sink sink;
+    for (int i = 0; i < aOptions.mClients; i++) {
+      sink.connect(server.getPort());
+      while (server.numClients() <= i)
+        server.process();
+    }
+    sink.start();
+
+    /* Poll the sockets as in a cycle, to send what was queued for the slow
+     * clients, until they have room for the next frame */
+    size_t limit = server.getMaxQueue() / 2;
+    BenchClock::time_point start = BenchClock::now();
+    for (int it = 0; it < aOptions.mIterations; it++) {
+      do
+        server.process();
+      while (server.maxQueued() + buffer.length() > limit && server.numClients() > 0);
+      server.sendToClients(frame);
+    }
+    double ns = elapsedNs(start);
+    sink.stop();
+    frame->release();
+
+    if (!checkClients("fan-out", aOptions, server.numClients()))
+      return false;
+    printf("fan-out:       %10.1f ns/send %10.1f ns/client %8.1f MB/s (%d bytes x %d clients)\n",
+      ns / aOptions.mIterations,
+      ns / aOptions.mIterations / aOptions.mClients,
+      (double) buffer.length() * aOptions.mIterations * aOptions.mClients / ns * 1000.0,
+      (int) buffer.length(), aOptions.mClients);
+    return true;
+  }
+
+  bool benchCycle(const Options &aOptions)
+  {
+    std::vector<std::unique_ptr<DeviceDatum> > data;
+    createData(aOptions, data);
+    AdapterCore core(0);
+    core.setEpoll(aOptions.mEpoll);
+    core.setIoThread(aOptions.mIoThread);
+    for (int i = 0; i < aOptions.mItems; i++) {
+      update(data[i].get(), i, 0);
+      core.addDatum(*data[i]);
+    }
+    core.start();
+
+    Sink sink;
+    for (int i = 0; i < aOptions.mClients; i++) {
+      sink.connect(core.getPort());
+      while (core.server()->numClients() <= i)
+        core.start();
+    }
+    /* Let the I/O thread send the initial data of the last client */
+    core.start();
+    if (aOptions.mIoThread)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    sink.start();
+
+    int changed = aOptions.mItems * aOptions.mChanged / 100;
+    if (changed < 1)
+      changed = 1;
+    Server *server = core.server();
+    size_t limit = server->getMaxQueue() / 2;
+    BenchClock::time_point start = BenchClock::now();
+    for (int it = 1; it <= aOptions.mIterations; it++) {
+      /* Do not publish faster than the frames are sent */
+      if (aOptions.mIoThread) {
+        while (server->pending() >= OUTBOX_SIZE / 2)
+          std::this_thread::yield();
+      }
+      else {
+        while (server->maxQueued() > limit && server->numClients() > 0)
+          server->process();
+      }
+      core.start();
+      for (int j = 0; j < changed; j++) {
+        int i = (it * changed + j) % aOptions.mItems;
+        update(data[i].get(), i, it);
+      }
+      core.finish();
+    }
+    double ns = elapsedNs(start);
+
+    /* Let the I/O thread send the last frames, or drop the clients it could not serve */
+    if (aOptions.mIoThread) {
+      while (server->pending() > 0)
+        std::this_thread::yield();
+      std::this_thread::sleep_for(std::chrono::milliseconds(IO_THREAD_TICK));
+    }
+    sink.stop();
+
+    if (!checkClients("cycle", aOptions, server->numClients()))
+      return false;
+    printf("cycle:         %10.1f ns/cycle %10.0f cycles/s (%d/%d items changed, %d clients%s)\n",
+      ns / aOptions.mIterations, aOptions.mIterations / ns * 1e9,
+      changed, aOptions.mItems, aOptions.mClients,
+      aOptions.mIoThread ? ", I/O thread" : "");
+    return true;
+  }
+
+  void usage(const char *aProgram)
+  {
+    fprintf(stderr, "Usage: %s [--items N] [--clients N] [--iterations N] [--changed PERCENT] [--epoll] [--io-thread]\n",
+      aProgram);
+    exit(1);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  options.mItems = 64;
+  options.mClients = 4;
+  options.mIterations = 20000;
+  options.mChanged = 10;
+  options.mEpoll = false;
+  options.mIoThread = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--epoll") == 0) {
+      options.mEpoll = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--io-thread") == 0) {
+      options.mIoThread = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      usage(argv[0]);
+    int value = atoi(argv[i + 1]);
+    if (value <= 0)
+      usage(argv[0]);
+    if (strcmp(argv[i], "--items") == 0)
+      options.mItems = value;
+    else if (strcmp(argv[i], "--clients") == 0)
+      options.mClients = value;
+    else if (strcmp(argv[i], "--iterations") == 0)
+      options.mIterations = value;
+    else if (strcmp(argv[i], "--changed") == 0)
+      options.mChanged = value;
+    else
+      usage(argv[0]);
+    i++;
+  }
+
+  gLogger = new Logger();
+  gLogger->setLogLevel(Logger::eWARNING);
+
+  benchSerialization(options);
+  bool ok = benchFanOut(options);
+  ok = benchCycle(options) && ok;
+
+  return ok ? 0 : 1;
+}
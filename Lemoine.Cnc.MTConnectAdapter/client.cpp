@@ -35,30 +35,261 @@
 #include "internal.hpp"
 #include "client.hpp"
 #include "server.hpp"
+#include "frame.hpp"
+#include "logger.hpp"
+
+#ifdef WIN32
+typedef WSABUF IoVector;
+#define IO_VECTOR_SET(v, data, len) { (v).buf = (char *) (data); (v).len = (ULONG) (len); }
+#else
+#include <sys/uio.h>
+typedef struct iovec IoVector;
+#define IO_VECTOR_SET(v, data, len) { (v).iov_base = (void *) (data); (v).iov_len = (len); }
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Maximum number of frames that are sent in a single call */
+const int MAX_IO_VECTORS = 64;
 
 /* Instance methods */
-Client::Client(SOCKET aSocket)
+Client::Client(SOCKET aSocket, size_t aMaxQueue)
 {
   mSocket = aSocket;
-  mHeartbeats = false;
+  mId = 0;
+  mInitialized = true;
+  mQueue = 0;
+  mQueueSize = mQueueHead = mQueueCount = mQueued = 0;
+  mMaxQueue = aMaxQueue;
+  mHeartbeat.setOwner(this);
+  mLastPing = mConnectedAt = 0;
+  mPingInterval = 0;
+  mPeerAddress = 0;
+  mPeerPort = 0;
+  mBytesSent = mPartialWrites = 0;
+  mQueueFull = false;
+  mReadable = false;
+  mWritable = true;
+  mPollWrite = false;
+  mInputStart = mInputLength = 0;
+  mDiscarding = false;
 }
 
 Client::~Client()
 {
   ::shutdown(mSocket, SHUT_RDWR);
   ::closesocket(mSocket);
+  while (mQueueCount > 0)
+  {
+    mQueue[mQueueHead].mFrame->release();
+    mQueueHead = (mQueueHead + 1) % mQueueSize;
+    mQueueCount--;
+  }
+  if (mQueue != 0)
+    free(mQueue);
+}
+
+void Client::onPoll(const Poller::Event &aEvent)
+{
+  if (aEvent.mReadable || aEvent.mError)
+    mReadable = true;
+  if (aEvent.mWritable)
+    mWritable = true;
+}
+
+/* Send some data without blocking.
+ * Returns the number of bytes that were sent (possibly 0), -1 in case of error */
+int Client::send(const char *aData, size_t aLen)
+{
+  int len = ::send(mSocket, aData, (int) aLen, MSG_NOSIGNAL);
+  if (len < 0)
+    return SOCKET_WOULD_BLOCK ? 0 : -1;
+  mBytesSent += len;
+  return len;
 }
 
 int Client::write(const char *aString)
 {
-  return ::send(mSocket, aString, (int) strlen(aString), 0);
+  Frame *frame = Frame::create(aString, strlen(aString));
+  if (frame == 0)
+    return -1;
+  int res = write(frame);
+  frame->release();
+  return res;
 }
 
-int Client::read(char *aBuffer, int aMaxLen)
+int Client::write(Frame *aFrame)
 {
-  int len = recv(mSocket, aBuffer, aMaxLen, 0);
-  if (len >= 0)
-    aBuffer[len] = 0;
-  
+  size_t sent = 0;
+
+  /* Nothing is waiting: try to send directly */
+  if (mQueueCount == 0 && mWritable)
+  {
+    int len = send(aFrame->data(), aFrame->length());
+    if (len < 0)
+      return -1;
+    sent = (size_t) len;
+    if (sent == aFrame->length())
+      return (int) sent;
+    mWritable = false;
+    mPartialWrites++;
+  }
+
+  if (!enqueue(aFrame, sent))
+  {
+    mQueueFull = true;
+    gLogger->warning("Client output queue is full (%d bytes), disconnecting", (int) mMaxQueue);
+    return -1;
+  }
+
+  return (int) aFrame->length();
+}
+
+/* Append a reference to the frame at the end of the queue */
+bool Client::enqueue(Frame *aFrame, size_t aOffset)
+{
+  size_t len = aFrame->length() - aOffset;
+  if (mQueued + len > mMaxQueue)
+    return false;
+
+  if (mQueueCount == mQueueSize)
+  {
+    size_t newSize = mQueueSize < 16 ? 16 : mQueueSize * 2;
+    QueuedFrame *newQueue = (QueuedFrame *) malloc(newSize * sizeof(QueuedFrame));
+    if (newQueue == 0)
+      return false;
+    for (size_t i = 0; i < mQueueCount; i++)
+      newQueue[i] = mQueue[(mQueueHead + i) % mQueueSize];
+    if (mQueue != 0)
+      free(mQueue);
+    mQueue = newQueue;
+    mQueueSize = newSize;
+    mQueueHead = 0;
+  }
+
+  QueuedFrame &entry = mQueue[(mQueueHead + mQueueCount) % mQueueSize];
+  aFrame->retain();
+  entry.mFrame = aFrame;
+  entry.mOffset = aOffset;
+  mQueueCount++;
+  mQueued += len;
+  return true;
+}
+
+/* Remove aLen bytes from the head of the queue, releasing the frames that were completely sent */
+void Client::consume(size_t aLen)
+{
+  mQueued -= aLen;
+  while (aLen > 0)
+  {
+    QueuedFrame &entry = mQueue[mQueueHead];
+    size_t remaining = entry.mFrame->length() - entry.mOffset;
+    if (aLen < remaining)
+    {
+      entry.mOffset += aLen;
+      return;
+    }
+    aLen -= remaining;
+    entry.mFrame->release();
+    mQueueHead = (mQueueHead + 1) % mQueueSize;
+    mQueueCount--;
+  }
+}
+
+int Client::flush()
+{
+  while (mQueueCount > 0)
+  {
+    IoVector vectors[MAX_IO_VECTORS];
+    int count = mQueueCount < (size_t) MAX_IO_VECTORS ? (int) mQueueCount : MAX_IO_VECTORS;
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+    {
+      QueuedFrame &entry = mQueue[(mQueueHead + i) % mQueueSize];
+      size_t len = entry.mFrame->length() - entry.mOffset;
+      IO_VECTOR_SET(vectors[i], entry.mFrame->data() + entry.mOffset, len);
+      total += len;
+    }
+
+#ifdef WIN32
+    DWORD sent = 0;
+    if (WSASend(mSocket, vectors, count, &sent, 0, NULL, NULL) == SOCKET_ERROR)
+#else
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = vectors;
+    message.msg_iovlen = count;
+    ssize_t sent = ::sendmsg(mSocket, &message, MSG_NOSIGNAL);
+    if (sent < 0)
+#endif
+    {
+      if (!SOCKET_WOULD_BLOCK)
+        return -1;
+      mWritable = false;
+      mPartialWrites++;
+      return 0;
+    }
+
+    consume((size_t) sent);
+    mBytesSent += sent;
+    if ((size_t) sent < total)
+    {
+      /* Partial write: the socket buffer is full */
+      mWritable = false;
+      mPartialWrites++;
+      return 0;
+    }
+  }
+
+  mWritable = true;
+  return 0;
+}
+
+int Client::receive()
+{
+  /* Move the partial line to the start of the buffer */
+  if (mInputStart > 0)
+  {
+    mInputLength -= mInputStart;
+    memmove(mInput, mInput + mInputStart, mInputLength);
+    mInputStart = 0;
+  }
+  if (mInputLength == CLIENT_INPUT_SIZE)
+  {
+    if (!mDiscarding)
+      gLogger->warning("A line sent by the client %u is too long, dropped", mId);
+    mInputLength = 0;
+    mDiscarding = true;
+  }
+
+  int len = recv(mSocket, mInput + mInputLength, (int) (CLIENT_INPUT_SIZE - mInputLength), 0);
+  if (len > 0)
+    mInputLength += len;
   return len;
 }
+
+bool Client::nextLine(char *&aLine)
+{
+  while (mInputStart < mInputLength)
+  {
+    char *start = mInput + mInputStart;
+    char *eol = (char *) memchr(start, '\n', mInputLength - mInputStart);
+    if (eol == 0)
+      return false;
+    mInputStart = eol + 1 - mInput;
+    if (mDiscarding)
+    {
+      mDiscarding = false;
+      continue;
+    }
+
+    if (eol > start && eol[-1] == '\r')
+      eol--;
+    *eol = '\0';
+    aLine = start;
+    return true;
+  }
+  return false;
+}
@@ -35,28 +35,98 @@
 #ifndef CLIENT_HPP
 #define CLIENT_HPP
 
+#include "poller.hpp"
+#include "timer_wheel.hpp"
+
+class Frame;
+
+/* Some constants */
+const size_t DEFAULT_MAX_QUEUE = 1024 * 1024; /* Default bound of the output queue of a client */
+const size_t CLIENT_INPUT_SIZE = 1024;  /* Longest line a client can send */
+
 /*
  * A wrapper around a client socket. An adapter is capable of managing
  * multiple sockets. 
+ *
+ * The socket is made non-blocking by the server. What cannot be sent immediately is kept in
+ * a bounded output queue, that is sent once the socket is writable again,
+ * so that a slow client never blocks the others.
+ *
+ * The queue does not copy the data: it keeps a reference to the frames,
+ * that are shared with the other clients, and sends them with a single
+ * scatter-gather call.
+ *
+ * What the client sends is split in lines in an input buffer of its own,
+ * whatever the way the lines are split or grouped in the packets. A
+ * partial line is kept for the next read; a line that is longer than the
+ * buffer is dropped.
  */
-class Client
+class Client : public PollHandler
 {
   /* Instance Variables */
 protected:
+  struct QueuedFrame {
+    Frame *mFrame;
+    size_t mOffset;   /* Number of bytes of the frame that were already sent */
+  };
+
   SOCKET mSocket;
+  QueuedFrame *mQueue;  /* Output queue: circular array of the frames that are not sent yet */
+  size_t mQueueSize;    /* Allocated number of entries in the queue */
+  size_t mQueueHead;    /* Position of the first frame to send in the queue */
+  size_t mQueueCount;   /* Number of frames in the queue */
+  size_t mQueued;       /* Number of bytes in the queue */
+  size_t mMaxQueue;     /* Maximum number of bytes in the queue */
+
+  char mInput[CLIENT_INPUT_SIZE];
+  size_t mInputStart;   /* Start of the first line that was not returned yet */
+  size_t mInputLength;  /* Number of bytes in the input buffer */
+  bool mDiscarding;     /* Dropping the end of a line that was too long */
+
+protected:
+  bool enqueue(Frame *aFrame, size_t aOffset);
+  void consume(size_t aLen);
+  int send(const char *aData, size_t aLen);
 
   /* class methods */
 public:
-  bool mHeartbeats;
-  unsigned int mLastHeartbeat;
+  unsigned int mId;
+  bool mInitialized; /* The client is sent the published data */
+  Timer mHeartbeat;  /* Scheduled once the client sent a PING */
+  unsigned long long mLastPing;  /* When the last PING was received (ms), 0 if none */
+  unsigned int mPingInterval;    /* Between the last two PINGs (ms) */
+  unsigned long long mConnectedAt; /* ms */
+  unsigned long mPeerAddress;    /* IPv4, network order */
+  unsigned short mPeerPort;
+  /* Counters, for the metrics */
+  unsigned long long mBytesSent;
+  unsigned long long mPartialWrites; /* Sends that did not take all the data */
+  bool mQueueFull;  /* The last write failed because the queue is full */
+  bool mReadable; /* Data is available according to the last poll */
+  bool mWritable; /* The socket is writable: the last send did not block */
+  bool mPollWrite; /* The writability is polled */
 
   /* Instance methods */
 public:
-  Client(SOCKET aSocket);
+  Client(SOCKET aSocket, size_t aMaxQueue = DEFAULT_MAX_QUEUE);
   ~Client();
+
+  virtual void onPoll(const Poller::Event &aEvent);
+
+  /* Send the frame, or queue what cannot be sent now.
+   * Returns -1 in case of error or if the queue is full */
+  int write(Frame *aFrame);
   int write(const char *aString);
-  int read(char *aBuffer, int aLen);
+  /* Send as much of the queue as possible. Returns -1 in case of error */
+  int flush();
+  /* Receive what is available in the input buffer, after the partial line.
+   * Returns the result of recv() */
+  int receive();
+  /* Get the next complete line, nul-terminated without its end of line.
+   * It is valid until the next call to receive() */
+  bool nextLine(char *&aLine);
   SOCKET socket() { return mSocket; }
+  size_t queued() { return mQueued; }
 };
 
 #endif
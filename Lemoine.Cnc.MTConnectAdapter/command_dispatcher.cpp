@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "command_dispatcher.hpp"
+#include "logger.hpp"
+
+#include <string.h>
+
+bool CommandDispatcher::add(const char *aName, CommandHandler *aHandler)
+{
+  size_t length = strlen(aName);
+  const char *arguments;
+  int count = mCount.load(std::memory_order_relaxed);
+  if (count >= MAX_COMMANDS || length == 0 || length >= COMMAND_NAME_LEN ||
+      find(aName, arguments) != 0)
+  {
+    gLogger->error("Cannot add the command %s", aName);
+    return false;
+  }
+
+  Entry &entry = mEntries[count];
+  memcpy(entry.mName, aName, length + 1);
+  entry.mLength = length;
+  entry.mHandler = aHandler;
+  mCount.store(count + 1, std::memory_order_release);
+  return true;
+}
+
+CommandHandler *CommandDispatcher::find(const char *aLine, const char *&aArguments)
+{
+  size_t length = strcspn(aLine, " \t");
+  int count = mCount.load(std::memory_order_acquire);
+  for (int i = 0; i < count; i++)
+  {
+    Entry &entry = mEntries[i];
+    if (entry.mLength == length && memcmp(entry.mName, aLine, length) == 0)
+    {
+      aArguments = aLine + length;
+      while (*aArguments == ' ' || *aArguments == '\t')
+        aArguments++;
+      return entry.mHandler;
+    }
+  }
+  return 0;
+}
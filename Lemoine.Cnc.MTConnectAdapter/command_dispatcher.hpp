@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef COMMAND_DISPATCHER_HPP
+#define COMMAND_DISPATCHER_HPP
+
+#include <stddef.h>
+#include <atomic>
+
+class Server;
+class Client;
+
+/* Some constants */
+const int MAX_COMMANDS = 16;
+const int COMMAND_NAME_LEN = 16;
+
+/*
+ * Handler of a "* <command> <arguments>" line sent by a client.
+ *
+ * It is called by the thread that processes the server (the I/O thread if
+ * there is one), and replies with Server::sendToClient(). It returns false
+ * if the client was removed.
+ */
+class CommandHandler
+{
+public:
+  virtual ~CommandHandler() { }
+  virtual bool onCommand(Server &aServer, Client *aClient, const char *aArguments) = 0;
+};
+
+/*
+ * The handlers of the commands of a server, looked up by name.
+ *
+ * The commands can be added by another thread than the one that
+ * dispatches, while the server runs. They cannot be removed.
+ */
+class CommandDispatcher
+{
+protected:
+  struct Entry {
+    char mName[COMMAND_NAME_LEN];
+    size_t mLength;
+    CommandHandler *mHandler;
+  };
+
+  Entry mEntries[MAX_COMMANDS];
+  std::atomic<int> mCount;
+
+public:
+  CommandDispatcher() : mCount(0) { }
+
+  /* Returns false if there are too many commands or if the name is taken */
+  bool add(const char *aName, CommandHandler *aHandler);
+  /* Find the handler of a command line (without the "* "), and the start of
+   * its arguments. Returns 0 if the command is unknown */
+  CommandHandler *find(const char *aLine, const char *&aArguments);
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "datum_registry.hpp"
+#include "device_datum.hpp"
+
+DatumRegistry::DatumRegistry(size_t aCapacity)
+{
+  mData.reserve(aCapacity);
+  size_t slots = 16;
+  while (slots < aCapacity * 2)
+    slots <<= 1;
+  rehash(slots);
+}
+
+/* FNV-1a */
+unsigned int DatumRegistry::hash(const char *aName)
+{
+  unsigned int h = 2166136261u;
+  for (const unsigned char *cp = (const unsigned char *) aName; *cp != '\0'; cp++)
+  {
+    h ^= *cp;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void DatumRegistry::rehash(size_t aNumSlots)
+{
+  Slot free;
+  free.mHash = 0;
+  free.mIndex = -1;
+  mSlots.assign(aNumSlots, free);
+  mMask = aNumSlots - 1;
+  for (size_t i = 0; i < mData.size(); i++)
+    insert(hash(mData[i]->getName()), (int) i);
+}
+
+void DatumRegistry::insert(unsigned int aHash, int aIndex)
+{
+  size_t pos = aHash & mMask;
+  while (mSlots[pos].mIndex >= 0)
+    pos = (pos + 1) & mMask;
+  mSlots[pos].mHash = aHash;
+  mSlots[pos].mIndex = aIndex;
+}
+
+bool DatumRegistry::add(DeviceDatum *aDatum)
+{
+  if (find(aDatum->getName()) != 0)
+    return false;
+
+  mData.push_back(aDatum);
+  if (mData.size() * 2 > mSlots.size())
+    rehash(mSlots.size() * 2);
+  else
+    insert(hash(aDatum->getName()), (int) mData.size() - 1);
+  return true;
+}
+
+DeviceDatum *DatumRegistry::find(const char *aName) const
+{
+  unsigned int h = hash(aName);
+  for (size_t pos = h & mMask; mSlots[pos].mIndex >= 0; pos = (pos + 1) & mMask)
+  {
+    const Slot &slot = mSlots[pos];
+    if (slot.mHash == h && strcmp(mData[slot.mIndex]->getName(), aName) == 0)
+      return mData[slot.mIndex];
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef DATUM_REGISTRY_HPP
+#define DATUM_REGISTRY_HPP
+
+#include <stddef.h>
+#include <vector>
+
+class DeviceDatum;
+
+/*
+ * The data values of an adapter: a growable array, in the order they were
+ * added, with a hash index on their name.
+ *
+ * The index uses open addressing with linear probing, and is kept at most
+ * half full.
+ */
+class DatumRegistry
+{
+protected:
+  struct Slot {
+    unsigned int mHash;
+    int mIndex;        /* Position in mData, -1 if the slot is free */
+  };
+
+  std::vector<DeviceDatum *> mData;
+  std::vector<Slot> mSlots;
+  size_t mMask;
+
+protected:
+  static unsigned int hash(const char *aName);
+  void rehash(size_t aNumSlots);
+  void insert(unsigned int aHash, int aIndex);
+
+public:
+  DatumRegistry(size_t aCapacity = 128);
+
+  /* Returns false if a data value with the same name was already added */
+  bool add(DeviceDatum *aDatum);
+  DeviceDatum *find(const char *aName) const;
+
+  int size() const { return (int) mData.size(); }
+  /* Returns 0 if out of range */
+  DeviceDatum *at(int aIndex) const
+  {
+    return (aIndex >= 0 && aIndex < (int) mData.size()) ? mData[aIndex] : 0;
+  }
+};
+
+#endif
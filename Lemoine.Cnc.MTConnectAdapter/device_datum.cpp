@@ -45,22 +45,64 @@ DeviceDatum::DeviceDatum(const char *aName)
 {
   strncpy(mName, aName, NAME_LEN);
   mName[NAME_LEN - 1] = '\0';
+  size_t len = strlen(mName);
+  mPrefix[0] = '|';
+  memcpy(mPrefix + 1, mName, len);
+  mPrefix[len + 1] = '|';
+  mPrefix[len + 2] = '\0';
+  mPrefixLength = len + 2;
   mChanged = false;
   mHasValue = false;
+  mChangeList = 0;
+  mNextChange = 0;
+  mInChangeList = false;
+  mMinInterval = mMaxSilence = 0;
+  mLastSent = 0;
+  mTimer.setOwner(this);
+  mWindow = 0;
+  mWindowStart = 0;
+  mWindowDuration = 0;
+  mSnapshotStale = true;
 }
 
 DeviceDatum::~DeviceDatum()
 {
 }
 
+void DeviceDatum::setDevice(const char *aDevice)
+{
+  snprintf(mPrefix, sizeof(mPrefix), "|%s:%s|", aDevice, mName);
+  mPrefixLength = strlen(mPrefix);
+  mSnapshotStale = true;
+}
+
+/* The value is added to the list if it changed before */
+void DeviceDatum::setChangeList(ChangeList *aChangeList)
+{
+  mChangeList = aChangeList;
+  if (mChanged && mChangeList != 0)
+    mChangeList->push(this);
+}
+
 bool DeviceDatum::append(StringBuffer &aBuffer)
 {
-  char buffer[1024];
-  aBuffer.append(toString(buffer, 1024));
+  writeTo(aBuffer);
   mChanged = false;
   return mChanged;
 }
 
+void DeviceDatum::writeText(StringBuffer &aBuffer, const char *aText)
+{
+  size_t len = strlen(aText);
+  char *dp = aBuffer.prepare(len);
+  for (size_t i = 0; i < len; i++)
+  {
+    char c = aText[i];
+    *dp++ = (c == '\n' || c == '\r') ? ' ' : c;
+  }
+  aBuffer.commit(dp);
+}
+
 bool DeviceDatum::hasInitialValue()
 {
   return mHasValue;
@@ -71,48 +113,28 @@ bool DeviceDatum::requiresFlush()
   return false;
 }
 
-void DeviceDatum::appendText(char *aBuffer, char *aValue, unsigned int aMaxLen)
-{
-  size_t len = strlen(aBuffer);
-  size_t max = aMaxLen - len;
-  char *cp = aValue, *dp = aBuffer + len;
-  for (size_t i = len; i < aMaxLen && *cp != '\0'; i++)
-  {
-    if (*cp == '\n' || *cp == '\r')
-      *dp = ' ';
-    else
-      *dp = *cp;
-    dp++; cp++;
-  }
-  *dp = '\0';
-}
-
 /*
  * Event methods
  */
 Event::Event(const char* aName) :
   DeviceDatum(aName)
 {
-  mValue[0] = 0;
 }
 
 bool Event::setValue(const char *aValue)
 {
-  if (strncmp(aValue, mValue, EVENT_VALUE_LEN) != 0 || !mHasValue)
+  if (mValue.set(aValue, EVENT_VALUE_LEN - 1) || !mHasValue)
   {
-    mChanged = true;
-    strncpy(mValue, aValue, EVENT_VALUE_LEN);
-    mValue[EVENT_VALUE_LEN - 1] = '\0';
+    markChanged();
     mHasValue = true;
   }
   return mChanged;
 }
 
-char *Event::toString(char *aBuffer, int aMaxLen)
+void Event::writeTo(StringBuffer &aBuffer)
 {
-  snprintf(aBuffer, aMaxLen, "|%s|", mName);
-  appendText(aBuffer, mValue, aMaxLen);
-  return aBuffer;
+  aBuffer.append(mPrefix, mPrefixLength);
+  writeText(aBuffer, mValue.c_str());
 }
 
 bool Event::unavailable()
@@ -134,7 +156,7 @@ bool IntEvent::setValue(int aValue)
 {
   if (aValue !=  mValue || !mHasValue || mUnavailable)
   {
-    mChanged = true;
+    markChanged();
     mValue = aValue;
     mHasValue = true;
     mUnavailable = false;
@@ -143,21 +165,20 @@ bool IntEvent::setValue(int aValue)
   return mChanged;
 }
 
-char *IntEvent::toString(char *aBuffer, int aMaxLen)
+void IntEvent::writeTo(StringBuffer &aBuffer)
 {
+  aBuffer.append(mPrefix, mPrefixLength);
   if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
+    aBuffer.append(sUnavailable);
   else
-    snprintf(aBuffer, aMaxLen, "|%s|%d", mName, mValue);
-
-  return aBuffer;
+    aBuffer.appendNumber((long long) mValue);
 }
 
 bool IntEvent::unavailable()
 {
   if (!mUnavailable)
   {
-    mChanged = true;
+    markChanged();
     mUnavailable = true;
   }
   
@@ -172,42 +193,251 @@ Sample::Sample(const char *aName)
 {
   mValue = 0.0;
   mUnavailable = false;
+  mDeadband = DEFAULT_DEADBAND;
+  mRelativeDeadband = 0.0;
+  mStatistics = 0;
+  mCount = 0;
+  mMin = mMax = mSum = mSumOfSquares = 0.0;
+  mResultDuration = 0;
+  mHasResults = false;
 }
- 
+
+void Sample::setWindow(unsigned int aPeriod, int aStatistics)
+{
+  mWindow = aPeriod;
+  mWindowStart = 0;
+  mStatistics = aStatistics & (eAVERAGE | eMAXIMUM | eMINIMUM | eRMS);
+  if (mStatistics == 0)
+    mStatistics = eAVERAGE;
+  mCount = 0;
+  mHasResults = false;
+  mSnapshotStale = true;
+}
+
 bool Sample::setValue(double aValue)
 {
-  if (fabs(aValue - mValue) > 0.000001 || !mHasValue ||
+  if (mWindow > 0)
+  {
+    if (mCount == 0 || aValue < mMin)
+      mMin = aValue;
+    if (mCount == 0 || aValue > mMax)
+      mMax = aValue;
+    if (mCount == 0)
+      mSum = mSumOfSquares = 0.0;
+    mSum += aValue;
+    mSumOfSquares += aValue * aValue;
+    mCount++;
+    mValue = aValue;
+    mHasValue = true;
+    mUnavailable = false;
+    markChanged();
+    return mChanged;
+  }
+
+  double deadband = mDeadband;
+  if (mRelativeDeadband > 0.0 && fabs(mValue) * mRelativeDeadband > deadband)
+    deadband = fabs(mValue) * mRelativeDeadband;
+
+  if (fabs(aValue - mValue) > deadband || !mHasValue ||
       mUnavailable)
   {
-      mChanged = true;
+      markChanged();
       mValue = aValue;
       mHasValue = true;
       mUnavailable = false;
   }
+  else if (aValue != mValue)
+    markSuppressed();
   return mChanged;
 }
 
-char *Sample::toString(char *aBuffer, int aMaxLen)
+void Sample::writeTo(StringBuffer &aBuffer)
 {
+  if (mWindow > 0)
+  {
+    /* Close the window */
+    if (mCount > 0)
+    {
+      mResults[0] = mSum / mCount;
+      mResults[1] = mMax;
+      mResults[2] = mMin;
+      mResults[3] = sqrt(mSumOfSquares / mCount);
+      mResultDuration = mWindowDuration;
+      mHasResults = true;
+      mCount = 0;
+      mSnapshotStale = true;
+    }
+    writeStatistics(aBuffer);
+    return;
+  }
+
+  aBuffer.append(mPrefix, mPrefixLength);
   if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
+    aBuffer.append(sUnavailable);
+  else
+    aBuffer.appendNumber(mValue, mFormat);
+}
+
+void Sample::writeSnapshotTo(StringBuffer &aBuffer)
+{
+  if (mWindow > 0)
+    writeStatistics(aBuffer);
   else
-    snprintf(aBuffer, aMaxLen, "|%s|%.10f", mName, mValue);
-  return aBuffer;
+    writeTo(aBuffer);
+}
+
+/* One line per statistic of the last window */
+void Sample::writeStatistics(StringBuffer &aBuffer)
+{
+  static const char *sSuffixes[4] = { "_avg", "_max", "_min", "_rms" };
+  bool single = (mStatistics & (mStatistics - 1)) == 0;
+  bool first = true;
+  for (int i = 0; i < 4; i++)
+  {
+    if ((mStatistics & (1 << i)) == 0)
+      continue;
+    if (!first)
+      aBuffer.newLine();
+    first = false;
+
+    if (mUnavailable)
+      aBuffer.append(mPrefix, mPrefixLength - 1);
+    else
+    {
+      /* The duration follows the timestamp of the line */
+      aBuffer.append('@').appendNumber(mResultDuration / 1000.0);
+      aBuffer.append(mPrefix, mPrefixLength - 1);
+    }
+    if (!single)
+      aBuffer.append(sSuffixes[i]);
+    aBuffer.append('|');
+    if (mUnavailable)
+      aBuffer.append(sUnavailable);
+    else
+      aBuffer.appendNumber(mResults[i], mFormat);
+  }
+}
+
+bool Sample::hasInitialValue()
+{
+  if (mWindow > 0)
+    return mHasResults || (mUnavailable && mHasValue);
+  return mHasValue;
+}
+
+bool Sample::requiresFlush()
+{
+  /* The duration applies to the whole line */
+  return mWindow > 0;
 }
 
 bool Sample::unavailable()
 {
   if (!mUnavailable)
   {
-    mChanged = true;
+    markChanged();
     mUnavailable = true;
+    mCount = 0;
+    mHasResults = false;
   }
   
   return mChanged;
 }
 
 
+/* Time series */
+
+TimeSeries::TimeSeries(const char *aName)
+  : DeviceDatum(aName)
+{
+  mRate = 0.0;
+  mMaxCount = TIME_SERIES_MAX_COUNT;
+  mUnavailable = false;
+}
+
+bool TimeSeries::addValue(double aValue)
+{
+  if (mValues.size() >= mMaxCount)
+  {
+    /* Drop the oldest half, not one value at a time */
+    size_t drop = mValues.size() - mMaxCount / 2;
+    mValues.erase(mValues.begin(), mValues.begin() + drop);
+  }
+  mValues.push_back(aValue);
+  mHasValue = true;
+  mUnavailable = false;
+  markChanged();
+  return mChanged;
+}
+
+bool TimeSeries::addValues(const double *aValues, int aCount)
+{
+  for (int i = 0; i < aCount; i++)
+    addValue(aValues[i]);
+  return mChanged;
+}
+
+void TimeSeries::commit()
+{
+  if (!mValues.empty())
+  {
+    mSent.swap(mValues);
+    mValues.clear();
+  }
+}
+
+void TimeSeries::writeValues(StringBuffer &aBuffer, const std::vector<double> &aValues)
+{
+  aBuffer.append(mPrefix, mPrefixLength);
+  if (mUnavailable)
+  {
+    aBuffer.append("||").append(sUnavailable);
+    return;
+  }
+
+  aBuffer.appendNumber((long long) aValues.size()).append('|');
+  if (mRate > 0.0)
+    aBuffer.appendNumber(mRate);
+  aBuffer.append('|');
+  for (size_t i = 0; i < aValues.size(); i++)
+  {
+    if (i > 0)
+      aBuffer.append(' ');
+    aBuffer.appendNumber(aValues[i], mFormat);
+  }
+}
+
+/* A change without new values (maximum silence) sends the last batch again */
+void TimeSeries::writeTo(StringBuffer &aBuffer)
+{
+  writeValues(aBuffer, mValues.empty() ? mSent : mValues);
+  commit();
+}
+
+void TimeSeries::writeSnapshotTo(StringBuffer &aBuffer)
+{
+  writeValues(aBuffer, mValues.empty() ? mSent : mValues);
+}
+
+void TimeSeries::reset()
+{
+  commit();
+  mChanged = false;
+}
+
+bool TimeSeries::unavailable()
+{
+  if (!mUnavailable)
+  {
+    mValues.clear();
+    mSent.clear();
+    mUnavailable = true;
+    markChanged();
+  }
+  return mChanged;
+}
+
+
 /* Power */
 
 bool PowerState::setValue(enum EPowerState aState)
@@ -215,24 +445,26 @@ bool PowerState::setValue(enum EPowerState aState)
   if (mState != aState || !mHasValue)
   {
     mState = aState;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
   return mChanged;
 }
 
-char *PowerState::toString(char *aBuffer, int aMaxLen)
+const char *PowerState::text()
 {
-  const char *text;
   switch(mState)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eON: text = "ON"; break;
-  case eOFF: text = "OFF"; break;
-  default: text = ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eON: return "ON";
+  case eOFF: return "OFF";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void PowerState::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool PowerState::unavailable()
@@ -247,27 +479,29 @@ bool Execution::setValue(enum EExecutionState aState)
   if (mState != aState || !mHasValue)
   {
     mState = aState;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
   
   return mChanged;
 }
 
-char *Execution::toString(char *aBuffer, int aMaxLen)
+const char *Execution::text()
 {
-  const char *text;
   switch(mState)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eACTIVE: text = "ACTIVE"; break;
-  case eREADY: text = "READY"; break;
-  case eINTERRUPTED: text = "INTERRUPTED"; break;
-  case eSTOPPED: text = "STOPPED"; break;
-  default: text = ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eACTIVE: return "ACTIVE";
+  case eREADY: return "READY";
+  case eINTERRUPTED: return "INTERRUPTED";
+  case eSTOPPED: return "STOPPED";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void Execution::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool Execution::unavailable()
@@ -277,20 +511,22 @@ bool Execution::unavailable()
 
 /* ControllerMode */
 
-char *ControllerMode::toString(char *aBuffer, int aMaxLen)
+const char *ControllerMode::text()
 {
-  const char *text;
   switch(mMode)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eSEMI_AUTOMATIC: text = "SEMI_AUTOMATIC"; break;
-  case eAUTOMATIC: text = "AUTOMATIC"; break;
-  case eMANUAL: text = "MANUAL"; break;
-  case eMANUAL_DATA_INPUT: text = "MANUAL_DATA_INPUT"; break;
-  default: text = ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eSEMI_AUTOMATIC: return "SEMI_AUTOMATIC";
+  case eAUTOMATIC: return "AUTOMATIC";
+  case eMANUAL: return "MANUAL";
+  case eMANUAL_DATA_INPUT: return "MANUAL_DATA_INPUT";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void ControllerMode::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool ControllerMode::setValue(enum EMode aMode)
@@ -298,7 +534,7 @@ bool ControllerMode::setValue(enum EMode aMode)
   if (mMode != aMode || !mHasValue)
   {
     mMode = aMode;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
 
@@ -312,18 +548,20 @@ bool ControllerMode::unavailable()
 
 /* Direction */
 
-char *Direction::toString(char *aBuffer, int aMaxLen)
+const char *Direction::text()
 {
-  const char *text;
   switch(mDirection)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eCLOCKWISE: text = "CLOCKWISE"; break;
-  case eCOUNTER_CLOCKWISE: text = "COUNTER_CLOCKWISE"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eCLOCKWISE: return "CLOCKWISE";
+  case eCOUNTER_CLOCKWISE: return "COUNTER_CLOCKWISE";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void Direction::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool Direction::setValue(enum ERotationDirection aDirection)
@@ -331,7 +569,7 @@ bool Direction::setValue(enum ERotationDirection aDirection)
   if (mDirection != aDirection || !mHasValue)
   {
     mDirection = aDirection;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
 
@@ -345,18 +583,20 @@ bool Direction::unavailable()
 
 /* Emergency Stop */
 
-char *EmergencyStop::toString(char *aBuffer, int aMaxLen)
+const char *EmergencyStop::text()
 {
-  const char *text;
   switch(mValue)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eTRIGGERED: text = "TRIGGERED"; break;
-  case eARMED: text = "ARMED"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eTRIGGERED: return "TRIGGERED";
+  case eARMED: return "ARMED";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void EmergencyStop::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool EmergencyStop::setValue(enum EValues aValue)
@@ -364,7 +604,7 @@ bool EmergencyStop::setValue(enum EValues aValue)
   if (mValue != aValue || !mHasValue)
   {
     mValue = aValue;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
 
@@ -378,20 +618,22 @@ bool EmergencyStop::unavailable()
 
 /* Axis Coupling */
 
-char *AxisCoupling::toString(char *aBuffer, int aMaxLen)
+const char *AxisCoupling::text()
 {
-  const char *text;
   switch(mValue)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eTANDEM: text = "TANDEM"; break;
-  case eSYNCHRONOUS: text = "SYNCHRONOUS"; break;
-  case eMASTER: text = "MASTER"; break;
-  case eSLAVE: text = "SLAVE"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eTANDEM: return "TANDEM";
+  case eSYNCHRONOUS: return "SYNCHRONOUS";
+  case eMASTER: return "MASTER";
+  case eSLAVE: return "SLAVE";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void AxisCoupling::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool AxisCoupling::setValue(enum EValues aValue)
@@ -399,7 +641,7 @@ bool AxisCoupling::setValue(enum EValues aValue)
   if (mValue != aValue || !mHasValue)
   {
     mValue = aValue;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
   return mChanged;
@@ -412,18 +654,20 @@ bool AxisCoupling::unavailable()
 
 /* Door State */
 
-char *DoorState::toString(char *aBuffer, int aMaxLen)
+const char *DoorState::text()
 {
-  const char *text;
   switch(mValue)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eOPEN: text = "CLOSED"; break;
-  case eCLOSED: text = "OPEN"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eOPEN: return "CLOSED";
+  case eCLOSED: return "OPEN";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void DoorState::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool DoorState::setValue(enum EValues aValue)
@@ -431,7 +675,7 @@ bool DoorState::setValue(enum EValues aValue)
   if (mValue != aValue || !mHasValue)
   {
     mValue = aValue;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
   return mChanged;
@@ -444,19 +688,21 @@ bool DoorState::unavailable()
 
 // Path Mode
 
-char *PathMode::toString(char *aBuffer, int aMaxLen)
+const char *PathMode::text()
 {
-  const char *text;
   switch(mValue)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eINDEPENDENT: text = "INDEPENDENT"; break;
-  case eSYNCHRONOUS: text = "SYNCHRONOUS"; break;
-  case eMIRROR: text = "MIRROR"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eINDEPENDENT: return "INDEPENDENT";
+  case eSYNCHRONOUS: return "SYNCHRONOUS";
+  case eMIRROR: return "MIRROR";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void PathMode::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool PathMode::setValue(enum EValues aValue)
@@ -464,7 +710,7 @@ bool PathMode::setValue(enum EValues aValue)
   if (mValue != aValue || !mHasValue)
   {
     mValue = aValue;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
   return mChanged;
@@ -477,19 +723,21 @@ bool PathMode::unavailable()
 
 // Rotary Mode
 
-char *RotaryMode::toString(char *aBuffer, int aMaxLen)
+const char *RotaryMode::text()
 {
-  const char *text;
   switch(mValue)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eSPINDLE: text = "SPINDLE"; break;
-  case eINDEX: text = "INDEX"; break;
-  case eCONTOUR: text = "CONTOUR"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eSPINDLE: return "SPINDLE";
+  case eINDEX: return "INDEX";
+  case eCONTOUR: return "CONTOUR";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s", mName, text);
-  return aBuffer;
+}
+
+void RotaryMode::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(text());
 }
 
 bool RotaryMode::setValue(enum EValues aValue)
@@ -497,7 +745,7 @@ bool RotaryMode::setValue(enum EValues aValue)
   if (mValue != aValue || !mHasValue)
   {
     mValue = aValue;
-    mChanged = true;
+    markChanged();
     mHasValue = true;
   }
   return mChanged;
@@ -513,53 +761,46 @@ bool RotaryMode::unavailable()
 Condition::Condition(const char *aName) :
   DeviceDatum(aName), mLevel(eUNAVAILABLE)
 {
-  mNativeCode[0] = mNativeSeverity[0] = mText[0] =
-   mQualifier[0] = 0;
 }
 
-char *Condition::toString(char *aBuffer, int aMaxLen)
+const char *Condition::levelText(ELevels aLevel)
 {
-  const char *text;
-  switch(mLevel)
+  switch(aLevel)
   {
-  case eUNAVAILABLE: text = sUnavailable; break;
-  case eNORMAL: text = "NORMAL"; break;
-  case eWARNING: text = "WARNING"; break;
-  case eFAULT: text = "FAULT"; break;
-  default: ""; break;
+  case eUNAVAILABLE: return sUnavailable;
+  case eNORMAL: return "NORMAL";
+  case eWARNING: return "WARNING";
+  case eFAULT: return "FAULT";
+  default: return "";
   }
-  snprintf(aBuffer, aMaxLen, "|%s|%s|%s|%s|%s|", mName, text, mNativeCode, mNativeSeverity,
-          mQualifier);
-  appendText(aBuffer, mText, aMaxLen);
-  return aBuffer;
+}
+
+void Condition::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength).append(levelText()).append('|');
+  aBuffer.append(mNativeCode.c_str(), mNativeCode.length()).append('|');
+  aBuffer.append(mNativeSeverity.c_str(), mNativeSeverity.length()).append('|');
+  aBuffer.append(mQualifier.c_str(), mQualifier.length()).append('|');
+  writeText(aBuffer, mText.c_str());
 }
 
  bool Condition::setValue(ELevels aLevel, const char *aText, const char *aCode,
         const char *aQualifier, const char *aSeverity)
 {
-  if (!mHasValue ||
-      mLevel != aLevel ||
-      strncmp(aCode, mNativeCode, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aQualifier, mQualifier, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aSeverity, mNativeSeverity, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aText, mText, EVENT_VALUE_LEN) != 0)
-    
-  {
-    mLevel = aLevel;
-    
-    strncpy(mNativeCode, aCode, EVENT_VALUE_LEN);
-    mNativeCode[EVENT_VALUE_LEN - 1] = '\0';
-    
-    strncpy(mQualifier, aQualifier, EVENT_VALUE_LEN);
-    mQualifier[EVENT_VALUE_LEN - 1] = '\0';
-
-    strncpy(mNativeSeverity, aSeverity, EVENT_VALUE_LEN);
-    mNativeSeverity[EVENT_VALUE_LEN - 1] = '\0';
-
-    strncpy(mText, aText, EVENT_VALUE_LEN);
-    mText[EVENT_VALUE_LEN - 1] = '\0';
-    
-    mChanged = true;
+  bool changed = mLevel != aLevel;
+  mLevel = aLevel;
+  if (mNativeCode.set(aCode, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (mQualifier.set(aQualifier, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (mNativeSeverity.set(aSeverity, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (mText.set(aText, EVENT_VALUE_LEN - 1))
+    changed = true;
+
+  if (changed || !mHasValue)
+  {
+    markChanged();
     mHasValue = true;
   }
   
@@ -576,41 +817,275 @@ bool Condition::unavailable()
   return setValue(eUNAVAILABLE);
 }
 
-// Message
+// ConditionSet
 
-Message::Message(const char *aName) :
-  DeviceDatum(aName)
+ConditionSet::ConditionSet(const char *aName) :
+  DeviceDatum(aName), mActiveCount(0), mDirtyCount(0), mUnavailable(true)
+{
+}
+
+ConditionSet::~ConditionSet()
+{
+  for (size_t i = 0; i < mActivations.size(); i++)
+    delete mActivations[i];
+  for (size_t i = 0; i < mFree.size(); i++)
+    delete mFree[i];
+}
+
+ConditionSet::Activation *ConditionSet::find(const char *aCode, size_t aLength,
+                                             unsigned int aHash)
+{
+  auto range = mIndex.equal_range(aHash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    Activation *activation = it->second;
+    if (activation->mNativeCode.length() == aLength &&
+        memcmp(activation->mNativeCode.c_str(), aCode, aLength) == 0)
+      return activation;
+  }
+  return 0;
+}
+
+void ConditionSet::removeFromIndex(Activation *aActivation)
 {
-  mNativeCode[0] = 0;
+  auto range = mIndex.equal_range(aActivation->mNativeCode.hash());
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (it->second == aActivation)
+    {
+      mIndex.erase(it);
+      return;
+    }
+  }
 }
 
-char *Message::toString(char *aBuffer, int aMaxLen)
+void ConditionSet::setDirty(Activation *aActivation)
+{
+  if (!aActivation->mDirty)
+  {
+    aActivation->mDirty = true;
+    mDirtyCount++;
+  }
+  markChanged();
+}
+
+void ConditionSet::begin()
+{
+  for (size_t i = 0; i < mActivations.size(); i++)
+    mActivations[i]->mSeen = false;
+}
+
+bool ConditionSet::add(Condition::ELevels aLevel, const char *aText, const char *aCode,
+                       const char *aQualifier, const char *aSeverity)
+{
+  if (aLevel != Condition::eWARNING && aLevel != Condition::eFAULT)
+    return false;
+
+  size_t length = strnlen(aCode, EVENT_VALUE_LEN - 1);
+  unsigned int hash = TextField::hash(aCode, length);
+  Activation *activation = find(aCode, length, hash);
+  bool changed = false;
+  if (activation == 0)
+  {
+    if (!mFree.empty())
+    {
+      activation = mFree.back();
+      mFree.pop_back();
+    }
+    else
+      activation = new Activation;
+    activation->mNativeCode.assign(aCode, length);
+    activation->mLevel = aLevel;
+    activation->mActive = activation->mDirty = false;
+    mActivations.push_back(activation);
+    mIndex.insert(std::make_pair(hash, activation));
+    changed = true;
+  }
+
+  if (activation->mLevel != aLevel)
+    changed = true;
+  activation->mLevel = aLevel;
+  if (activation->mText.set(aText, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (activation->mQualifier.set(aQualifier, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (activation->mNativeSeverity.set(aSeverity, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (!activation->mActive)
+  {
+    activation->mActive = true;
+    mActiveCount++;
+    changed = true;
+  }
+  activation->mSeen = true;
+
+  if (changed)
+    setDirty(activation);
+  return changed;
+}
+
+bool ConditionSet::end()
+{
+  for (size_t i = 0; i < mActivations.size(); i++)
+  {
+    Activation *activation = mActivations[i];
+    if (activation->mActive && !activation->mSeen)
+    {
+      activation->mActive = false;
+      mActiveCount--;
+      setDirty(activation);
+    }
+  }
+
+  if (mUnavailable || !mHasValue)
+  {
+    mUnavailable = false;
+    mHasValue = true;
+    markChanged();
+  }
+  return mChanged;
+}
+
+void ConditionSet::commit()
+{
+  for (size_t i = 0; i < mActivations.size(); )
+  {
+    Activation *activation = mActivations[i];
+    activation->mDirty = false;
+    if (activation->mActive)
+      i++;
+    else
+    {
+      removeFromIndex(activation);
+      mFree.push_back(activation);
+      mActivations[i] = mActivations.back();
+      mActivations.pop_back();
+    }
+  }
+  mDirtyCount = 0;
+}
+
+void ConditionSet::writeLine(StringBuffer &aBuffer, const char *aLevel,
+                             const TextField &aCode, const TextField &aSeverity,
+                             const TextField &aQualifier, const TextField &aText)
+{
+  aBuffer.append(aLevel).append('|');
+  aBuffer.append(aCode.c_str(), aCode.length()).append('|');
+  aBuffer.append(aSeverity.c_str(), aSeverity.length()).append('|');
+  aBuffer.append(aQualifier.c_str(), aQualifier.length()).append('|');
+  writeText(aBuffer, aText.c_str());
+}
+
+void ConditionSet::writeSnapshotTo(StringBuffer &aBuffer)
+{
+  if (mUnavailable || mActiveCount == 0)
+  {
+    aBuffer.append(mPrefix, mPrefixLength);
+    aBuffer.append(mUnavailable ? sUnavailable : "NORMAL").append("||||");
+    return;
+  }
+
+  bool first = true;
+  for (size_t i = 0; i < mActivations.size(); i++)
+  {
+    Activation *activation = mActivations[i];
+    if (!activation->mActive)
+      continue;
+    if (!first)
+      aBuffer.newLine();
+    first = false;
+    aBuffer.append(mPrefix, mPrefixLength);
+    writeLine(aBuffer, Condition::levelText(activation->mLevel), activation->mNativeCode,
+              activation->mNativeSeverity, activation->mQualifier, activation->mText);
+  }
+}
+
+/* The changes only. The complete state if nothing is pending (maximum
+ * silence), or if all the alarms were cleared: a single NORMAL */
+void ConditionSet::writeTo(StringBuffer &aBuffer)
+{
+  if (mDirtyCount == 0 || mActiveCount == 0 || mUnavailable)
+  {
+    writeSnapshotTo(aBuffer);
+    commit();
+    return;
+  }
+
+  bool first = true;
+  for (size_t i = 0; i < mActivations.size(); i++)
+  {
+    Activation *activation = mActivations[i];
+    if (!activation->mDirty)
+      continue;
+    if (!first)
+      aBuffer.newLine();
+    first = false;
+    aBuffer.append(mPrefix, mPrefixLength);
+    if (activation->mActive)
+      writeLine(aBuffer, Condition::levelText(activation->mLevel), activation->mNativeCode,
+                activation->mNativeSeverity, activation->mQualifier, activation->mText);
+    else
+      aBuffer.append("NORMAL|").append(activation->mNativeCode.c_str(),
+                                       activation->mNativeCode.length()).append("|||");
+  }
+  commit();
+}
+
+void ConditionSet::reset()
+{
+  commit();
+  mChanged = false;
+}
+
+bool ConditionSet::requiresFlush()
+{
+  return true;
+}
+
+bool ConditionSet::unavailable()
+{
+  if (mUnavailable && mHasValue)
+    return mChanged;
+
+  for (size_t i = 0; i < mActivations.size(); i++)
+    mFree.push_back(mActivations[i]);
+  mActivations.clear();
+  mIndex.clear();
+  mActiveCount = mDirtyCount = 0;
+  mUnavailable = true;
+  mHasValue = true;
+  markChanged();
+  return mChanged;
+}
+
+// Message
+
+Message::Message(const char *aName) :
+  DeviceDatum(aName)
 {
-  snprintf(aBuffer, aMaxLen, "|%s|%s|", mName, mNativeCode);
-  appendText(aBuffer, mText, aMaxLen);
-  return aBuffer;
 }
 
  bool Message::setValue(const char *aText, const char *aCode)
 {
-  if (!mHasValue ||
-      strncmp(aCode, mNativeCode, EVENT_VALUE_LEN) != 0 ||
-      strncmp(aText, mText, EVENT_VALUE_LEN) != 0)
-    
-  {
-    strncpy(mNativeCode, aCode, EVENT_VALUE_LEN);
-    mNativeCode[EVENT_VALUE_LEN - 1] = '\0';
-    
-    strncpy(mText, aText, EVENT_VALUE_LEN);
-    mText[EVENT_VALUE_LEN - 1] = '\0';
-    
-    mChanged = true;
+  bool changed = mNativeCode.set(aCode, EVENT_VALUE_LEN - 1);
+  if (mText.set(aText, EVENT_VALUE_LEN - 1))
+    changed = true;
+  if (changed || !mHasValue)
+  {
+    markChanged();
     mHasValue = true;
   }
   
   return mChanged;
 }
 
+void Message::writeTo(StringBuffer &aBuffer)
+{
+  aBuffer.append(mPrefix, mPrefixLength);
+  aBuffer.append(mNativeCode.c_str(), mNativeCode.length()).append('|');
+  writeText(aBuffer, mText.c_str());
+}
+
 bool Message::requiresFlush()
 {
   return true;
@@ -629,38 +1104,45 @@ PathPosition::PathPosition(const char *aName)
 {
   mX = mY = mZ = 0.0;
   mUnavailable = false;
+  mDeadband = DEFAULT_DEADBAND;
+  mDistanceDeadband = 0.0;
 }
  
 bool PathPosition::setValue(double aX, double aY, double aZ)
 {
-  if (!mHasValue ||
-      fabs(aX - mX) > 0.000001 ||
-      fabs(aY - mY) > 0.000001 ||
-      fabs(aZ - mZ) > 0.000001 ||
-      mUnavailable)
+  double dx = aX - mX, dy = aY - mY, dz = aZ - mZ;
+  if (!mHasValue || mUnavailable ||
+      ((fabs(dx) > mDeadband || fabs(dy) > mDeadband || fabs(dz) > mDeadband) &&
+       dx * dx + dy * dy + dz * dz > mDistanceDeadband * mDistanceDeadband))
   {
-      mChanged = true;
+      markChanged();
       mX = aX; mY = aY; mZ = aZ;
       mHasValue = true;
       mUnavailable = false;
   }
+  else if (dx != 0.0 || dy != 0.0 || dz != 0.0)
+    markSuppressed();
   return mChanged;
 }
 
-char *PathPosition::toString(char *aBuffer, int aMaxLen)
+void PathPosition::writeTo(StringBuffer &aBuffer)
 {
+  aBuffer.append(mPrefix, mPrefixLength);
   if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
+    aBuffer.append(sUnavailable);
   else
-    snprintf(aBuffer, aMaxLen, "|%s|%.10f %0.10f %0.10f", mName, mX, mY, mZ);
-  return aBuffer;
+  {
+    aBuffer.appendNumber(mX, mFormat).append(' ');
+    aBuffer.appendNumber(mY, mFormat).append(' ');
+    aBuffer.appendNumber(mZ, mFormat);
+  }
 }
 
 bool PathPosition::unavailable()
 {
   if (!mUnavailable)
   {
-    mChanged = true;
+    markChanged();
     mUnavailable = true;
   }
   
@@ -678,20 +1160,17 @@ Availability::Availability(const char *aName)
   mHasValue = true;
 }
  
-char *Availability::toString(char *aBuffer, int aMaxLen)
+void Availability::writeTo(StringBuffer &aBuffer)
 {
-  if (mUnavailable)
-    snprintf(aBuffer, aMaxLen, "|%s|UNAVAILABLE", mName);
-  else
-    snprintf(aBuffer, aMaxLen, "|%s|AVAILABLE", mName);
-  return aBuffer;
+  aBuffer.append(mPrefix, mPrefixLength);
+  aBuffer.append(mUnavailable ? sUnavailable : "AVAILABLE");
 }
 
 bool Availability::unavailable()
 {
   if (!mUnavailable)
   {
-    mChanged = true;
+    markChanged();
     mUnavailable = true;
   }
   
@@ -702,7 +1181,7 @@ bool Availability::available()
 {
   if (mUnavailable)
   {
-    mChanged = true;
+    markChanged();
     mUnavailable = false;
   }
   
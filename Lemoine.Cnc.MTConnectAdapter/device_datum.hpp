@@ -35,8 +35,17 @@
 #ifndef DEVICE_DATUM_HPP
 #define DEVICE_DATUM_HPP
 
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+#include "float_format.hpp"
+#include "text_field.hpp"
+#include "timer_wheel.hpp"
+
 /* Forward class definitions */
 class StringBuffer;
+class ChangeList;
 
 /* Some constants for field lengths */
 const int NAME_LEN = 32;
@@ -47,6 +56,9 @@ const int STATE_LEN = 32;
 const int DESCRIPTION_LEN = 512;
 const int EVENT_VALUE_LEN = 512;
 
+/* Default absolute deadband of the samples */
+const double DEFAULT_DEADBAND = 0.000001;
+
 /*
  * An abstract data value that knows its name and tracks when it has changed. 
  * 
@@ -56,6 +68,10 @@ class DeviceDatum {
 protected:
   /* The name of the Data Value */
   char mName[NAME_LEN];
+
+  /* "|name|", or "|device:name|", rendered once */
+  char mPrefix[2 * NAME_LEN + 2];
+  size_t mPrefixLength;
   
   /* A changed flag to indicated that the value has changed since last append. */
   bool mChanged;
@@ -63,18 +79,64 @@ protected:
   /* Has this data value been initialized? */
   bool mHasValue;
 
+  /* The list of the changed values of the adapter, and the link in it */
+  ChangeList *mChangeList;
+  DeviceDatum *mNextChange;
+  bool mInChangeList;
+
+  /* Rate limits (ms, 0: none), when the value was sent, and when it is
+   * checked again */
+  unsigned int mMinInterval;
+  unsigned int mMaxSilence;
+  unsigned long long mLastSent;
+  Timer mTimer;
+
+  /* Aggregation window (ms, 0: the value is sent on change), when the current
+   * window started (0: not started), and the duration of the window sent */
+  unsigned int mWindow;
+  unsigned long long mWindowStart;
+  unsigned int mWindowDuration;
+
+  /* The value as written to a new client, encoded again once it changed */
+  TextField mSnapshot;
+  bool mSnapshotStale;
+
+  friend class ChangeList;
+  friend class AdapterCore;
+
 protected:
-  void appendText(char *aBuffer, char *aValue, unsigned int aMaxLen);
+  /* Append a free text, with the line breaks replaced by spaces */
+  static void writeText(StringBuffer &aBuffer, const char *aText);
+  /* Flag the value as changed, and add it to the list of changes */
+  void markChanged();
+  /* Count a new value that was dropped by a deadband */
+  void markSuppressed();
 
 public:
   DeviceDatum(const char *aName);
   virtual ~DeviceDatum();
   
   bool changed() { return mChanged; }
-  void reset() { mChanged = false; }
+  virtual void reset() { mChanged = false; }
+  void setChangeList(ChangeList *aChangeList);
+
+  /* A change is held until aMinInterval ms passed since the value was last
+   * sent, and then the latest value is sent */
+  void setMinInterval(unsigned int aMinInterval) { mMinInterval = aMinInterval; }
+  unsigned int getMinInterval() { return mMinInterval; }
+  /* The value is sent again if it did not change for aMaxSilence ms */
+  void setMaxSilence(unsigned int aMaxSilence) { mMaxSilence = aMaxSilence; }
+  unsigned int getMaxSilence() { return mMaxSilence; }
+  unsigned int getWindow() { return mWindow; }
   
   char *getName() { return mName; }
-  virtual char *toString(char *aBuffer, int aMaxLen) = 0;
+  /* Prefix the name with a device name, for an adapter that shares its port */
+  void setDevice(const char *aDevice);
+  /* Write "|name|value" at the end of the buffer */
+  virtual void writeTo(StringBuffer &aBuffer) = 0;
+  /* Write the current value for a new client, without consuming the change.
+   * By default, the same as writeTo() */
+  virtual void writeSnapshotTo(StringBuffer &aBuffer) { writeTo(aBuffer); }
   virtual bool append(StringBuffer &aBuffer);
   virtual bool hasInitialValue();
   virtual bool requiresFlush();
@@ -82,19 +144,89 @@ public:
   virtual bool unavailable() = 0;
 };
 
+/*
+ * Intrusive FIFO list of the data values that changed since they were
+ * last sent, so that a cycle only visits what changed.
+ *
+ * It is owned by the adapter. The values add themselves when they change,
+ * only once until they are popped.
+ */
+class ChangeList
+{
+protected:
+  DeviceDatum *mHead;
+  DeviceDatum *mTail;
+  unsigned int mSuppressed;  /* New values dropped by a deadband */
+
+public:
+  ChangeList() : mHead(0), mTail(0), mSuppressed(0) { }
+
+  bool empty() { return mHead == 0; }
+
+  void suppressed() { mSuppressed++; }
+  /* The values dropped by a deadband since the previous call */
+  unsigned int takeSuppressed()
+  {
+    unsigned int suppressed = mSuppressed;
+    mSuppressed = 0;
+    return suppressed;
+  }
+
+  void push(DeviceDatum *aDatum)
+  {
+    if (aDatum->mInChangeList)
+      return;
+    aDatum->mInChangeList = true;
+    aDatum->mNextChange = 0;
+    if (mTail != 0)
+      mTail->mNextChange = aDatum;
+    else
+      mHead = aDatum;
+    mTail = aDatum;
+  }
+
+  /* Returns 0 once empty */
+  DeviceDatum *pop()
+  {
+    DeviceDatum *datum = mHead;
+    if (datum != 0) {
+      mHead = datum->mNextChange;
+      if (mHead == 0)
+        mTail = 0;
+      datum->mNextChange = 0;
+      datum->mInChangeList = false;
+    }
+    return datum;
+  }
+};
+
+inline void DeviceDatum::markChanged()
+{
+  mChanged = true;
+  mSnapshotStale = true;
+  if (mChangeList != 0)
+    mChangeList->push(this);
+}
+
+inline void DeviceDatum::markSuppressed()
+{
+  if (mChangeList != 0)
+    mChangeList->suppressed();
+}
+
 /*
  * An event is a data value with a string value.
  */
 class Event : public DeviceDatum 
 {
 protected:
-  char mValue[EVENT_VALUE_LEN];
+  TextField mValue;
 
 public:
   Event(const char *aName);
   bool setValue(const char *aValue);
-  const char *getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *getValue() { return mValue.c_str(); }
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -113,26 +245,116 @@ public:
   IntEvent(const char *aName);
   bool setValue(int aValue);
   int getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual void writeTo(StringBuffer &aBuffer);
   
   virtual bool unavailable();
 };
 
 /*
  * A sample event is used for floating point samples.
+ *
+ * A new value is only sent if it moved out of the deadband around the last
+ * sent value. The deadband is the largest of an absolute deadband and a
+ * relative one, a percentage of the last sent value.
  */
 
 class Sample : public DeviceDatum 
 {
+public:
+  /* Statistics of the aggregation windows */
+  enum EStatistic {
+    eAVERAGE = 1,
+    eMAXIMUM = 2,
+    eMINIMUM = 4,
+    eRMS = 8
+  };
+
 protected:
   double mValue;
   bool mUnavailable;
+  FloatFormat mFormat;
+  double mDeadband;          /* Absolute deadband */
+  double mRelativeDeadband;  /* Relative deadband, as a fraction of the value */
+
+  /* Aggregation window: accumulated values, and the last statistics sent */
+  int mStatistics;
+  unsigned int mCount;
+  double mMin, mMax, mSum, mSumOfSquares;
+  double mResults[4];
+  unsigned int mResultDuration;
+  bool mHasResults;
+
+protected:
+  void writeStatistics(StringBuffer &aBuffer);
 
 public:
   Sample(const char *aName);
+  /* Aggregate the values over windows of aPeriod ms instead of sending each
+   * change (0: back to send on change). At the end of each window, one line
+   * "timestamp@duration|name|value" is sent per statistic of aStatistics
+   * (EStatistic flags), with the duration in seconds. With a single
+   * statistic, the line has the name of the sample; with several, the name
+   * is suffixed with _avg, _max, _min or _rms. The minimum interval and the
+   * maximum silence do not apply to an aggregated sample */
+  void setWindow(unsigned int aPeriod, int aStatistics = eAVERAGE);
+  int getStatistics() { return mStatistics; }
   bool setValue(double aValue);
   double getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  void setDeadband(double aDeadband) { mDeadband = aDeadband; }
+  double getDeadband() { return mDeadband; }
+  void setRelativeDeadband(double aPercent) { mRelativeDeadband = aPercent / 100.0; }
+  double getRelativeDeadband() { return mRelativeDeadband * 100.0; }
+  void setPrecision(int aDecimals) { mFormat.setDecimals(aDecimals); mSnapshotStale = true; }
+  void setSignificantDigits(int aDigits) { mFormat.setSignificantDigits(aDigits); mSnapshotStale = true; }
+  FloatFormat &getFormat() { return mFormat; }
+  virtual void writeTo(StringBuffer &aBuffer);
+  virtual void writeSnapshotTo(StringBuffer &aBuffer);
+  virtual bool hasInitialValue();
+  virtual bool requiresFlush();
+
+  virtual bool unavailable();
+};
+
+/* Time series of a high-rate signal. The values added between two cycles
+ * are sent as a single line: |name|count|rate|v1 v2 ...
+ * The rate is the sample rate in Hz, left empty when it is not set. A new
+ * client gets the last batch. */
+
+const size_t TIME_SERIES_MAX_COUNT = 4096;  /* Values kept between two cycles, by default */
+
+class TimeSeries : public DeviceDatum
+{
+protected:
+  std::vector<double> mValues;  /* Not sent yet */
+  std::vector<double> mSent;    /* Last batch that was sent */
+  double mRate;
+  size_t mMaxCount;
+  bool mUnavailable;
+  FloatFormat mFormat;
+
+protected:
+  /* The pending values become the last batch */
+  void commit();
+  void writeValues(StringBuffer &aBuffer, const std::vector<double> &aValues);
+
+public:
+  TimeSeries(const char *aName);
+  bool addValue(double aValue);
+  bool addValues(const double *aValues, int aCount);
+  int count() { return (int) mValues.size(); }
+  void setRate(double aRate) { mRate = aRate; mSnapshotStale = true; }
+  double getRate() { return mRate; }
+  /* Maximum number of values in a batch. The oldest values are dropped
+   * when it is reached, for example when no client reads them */
+  void setMaxCount(int aCount) { mMaxCount = aCount > 1 ? aCount : 1; }
+  int getMaxCount() { return (int) mMaxCount; }
+  void setPrecision(int aDecimals) { mFormat.setDecimals(aDecimals); mSnapshotStale = true; }
+  void setSignificantDigits(int aDigits) { mFormat.setSignificantDigits(aDigits); mSnapshotStale = true; }
+  FloatFormat &getFormat() { return mFormat; }
+
+  virtual void writeTo(StringBuffer &aBuffer);
+  virtual void writeSnapshotTo(StringBuffer &aBuffer);
+  virtual void reset();
 
   virtual bool unavailable();
 };
@@ -155,7 +377,8 @@ public:
   PowerState(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EPowerState aState);
   EPowerState getValue() { return mState; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
   
   virtual bool unavailable();
 };
@@ -180,7 +403,8 @@ public:
   Execution(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EExecutionState aState);
   EExecutionState getValue() { return mState; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
   
   virtual bool unavailable();
 };
@@ -205,7 +429,8 @@ public:
   ControllerMode(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EMode aState);
   EMode getValue() { return mMode; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -229,7 +454,8 @@ public:
   Direction(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum ERotationDirection aDirection);
   ERotationDirection getValue() { return mDirection; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -254,7 +480,8 @@ public:
   EmergencyStop(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EValues aValue);
   EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -278,7 +505,8 @@ public:
   AxisCoupling(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EValues aValue);
   EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -299,7 +527,8 @@ public:
   DoorState(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EValues aValue);
   EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -321,7 +550,8 @@ public:
   PathMode(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EValues aValue);
   EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -343,7 +573,8 @@ public:
   RotaryMode(const char *aName) : DeviceDatum(aName) { }
   bool setValue(enum EValues aValue);
   EValues getValue() { return mValue; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *text();
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();
 };
@@ -362,53 +593,136 @@ public:
 
 protected:
   ELevels mLevel;
-  char mText[EVENT_VALUE_LEN];
-  char mNativeCode[EVENT_VALUE_LEN];
-  char mNativeSeverity[EVENT_VALUE_LEN];
-  char mQualifier[EVENT_VALUE_LEN];
+  TextField mText;
+  TextField mNativeCode;
+  TextField mNativeSeverity;
+  TextField mQualifier;
 
 public:
   Condition(const char *aName);
   bool setValue(ELevels aLevel, const char *aText = "", const char *aCode = "",
     const char *aQualifier = "", const char *aSeverity = ""); 
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  const char *levelText() { return levelText(mLevel); }
+  static const char *levelText(ELevels aLevel);
+  virtual void writeTo(StringBuffer &aBuffer);
 
   ELevels getLevel() { return mLevel; }
-  const char *getText() { return mText; }
-  const char *getNativeCode() { return mNativeCode; }
-  const char *getNativeSeverity() { return mNativeSeverity; }
-  const char *getQualifier() { return mQualifier; }
+  const char *getText() { return mText.c_str(); }
+  const char *getNativeCode() { return mNativeCode.c_str(); }
+  const char *getNativeSeverity() { return mNativeSeverity.c_str(); }
+  const char *getQualifier() { return mQualifier.c_str(); }
+
+  virtual bool requiresFlush();
+  virtual bool unavailable();
+};
+
+/*
+ * A condition with several simultaneous activations, one per native code,
+ * for example the active alarms of a control.
+ *
+ * Each cycle, the complete list of the active alarms is submitted between
+ * begin() and end(). Only the activations, the changes and the clears are
+ * sent, one line per native code, and a single NORMAL once no alarm is
+ * active anymore. A new client gets all the active alarms. The activations
+ * are indexed by the hash of their native code, so that submitting an alarm
+ * does not depend on the number of the active ones.
+ */
+class ConditionSet : public DeviceDatum
+{
+protected:
+  struct Activation {
+    Condition::ELevels mLevel;
+    TextField mNativeCode;
+    TextField mText;
+    TextField mNativeSeverity;
+    TextField mQualifier;
+    bool mSeen;    /* Submitted during the current cycle */
+    bool mActive;  /* Still active. Once cleared, kept until the clear is sent */
+    bool mDirty;   /* Not sent yet */
+  };
+
+  std::vector<Activation *> mActivations;
+  std::unordered_multimap<unsigned int, Activation *> mIndex;  /* By hash of the native code */
+  std::vector<Activation *> mFree;   /* Cleared activations, for reuse */
+  int mActiveCount;
+  int mDirtyCount;
+  bool mUnavailable;
+
+protected:
+  Activation *find(const char *aCode, size_t aLength, unsigned int aHash);
+  void removeFromIndex(Activation *aActivation);
+  void setDirty(Activation *aActivation);
+  /* Forget the sent clears once they were written */
+  void commit();
+  static void writeLine(StringBuffer &aBuffer, const char *aLevel,
+    const TextField &aCode, const TextField &aSeverity,
+    const TextField &aQualifier, const TextField &aText);
+
+public:
+  ConditionSet(const char *aName);
+  virtual ~ConditionSet();
+
+  /* Start the list of the active alarms of the cycle */
+  void begin();
+  /* Add an active alarm, at the WARNING or FAULT level.
+   * Returns true if it is new or changed */
+  bool add(Condition::ELevels aLevel, const char *aText, const char *aCode,
+    const char *aQualifier = "", const char *aSeverity = "");
+  /* Clear the alarms that were not added since begin() */
+  bool end();
+
+  int activeCount() { return mActiveCount; }
+
+  virtual void writeTo(StringBuffer &aBuffer);
+  virtual void writeSnapshotTo(StringBuffer &aBuffer);
+  virtual void reset();
 
   virtual bool requiresFlush();
   virtual bool unavailable();
 };
 
 class Message : public DeviceDatum {
-  char mText[EVENT_VALUE_LEN];
-  char mNativeCode[EVENT_VALUE_LEN];
+  TextField mText;
+  TextField mNativeCode;
 
 public:
   Message(const char *aName);
   bool setValue(const char *aText, const char *aCode = ""); 
-  virtual char *toString(char *aBuffer, int aMaxLen);
-  const char *getNativeCode() { return mNativeCode; }
+  virtual void writeTo(StringBuffer &aBuffer);
+  const char *getText() { return mText.c_str(); }
+  const char *getNativeCode() { return mNativeCode.c_str(); }
   
   virtual bool requiresFlush();  
   virtual bool unavailable();
 };
   
+/*
+ * A path position is sent if one of its coordinates moved out of the
+ * absolute deadband, and if the distance to the last sent position is
+ * larger than the distance deadband (0 by default).
+ */
 class PathPosition : public DeviceDatum {
 protected:
   double mX, mY, mZ;
   bool mUnavailable;
+  FloatFormat mFormat;
+  double mDeadband;          /* Absolute deadband of each coordinate */
+  double mDistanceDeadband;  /* Euclidean distance deadband */
 
 public:
   PathPosition(const char *aName);
   bool setValue(double aX, double aY, double aZ);
+  void setDeadband(double aDeadband) { mDeadband = aDeadband; }
+  double getDeadband() { return mDeadband; }
+  void setDistanceDeadband(double aDistance) { mDistanceDeadband = aDistance; }
+  double getDistanceDeadband() { return mDistanceDeadband; }
   double getX() { return mX; }
   double getY() { return mY; }
   double getZ() { return mZ; }
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  void setPrecision(int aDecimals) { mFormat.setDecimals(aDecimals); mSnapshotStale = true; }
+  void setSignificantDigits(int aDigits) { mFormat.setSignificantDigits(aDigits); mSnapshotStale = true; }
+  FloatFormat &getFormat() { return mFormat; }
+  virtual void writeTo(StringBuffer &aBuffer);
 
   virtual bool unavailable();  
 };
@@ -420,7 +734,7 @@ protected:
 
 public:
   Availability(const char *aName);
-  virtual char *toString(char *aBuffer, int aMaxLen);
+  virtual void writeTo(StringBuffer &aBuffer);
   bool available();
   virtual bool unavailable();  
 };
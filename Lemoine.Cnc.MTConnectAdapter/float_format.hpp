@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef FLOAT_FORMAT_HPP
+#define FLOAT_FORMAT_HPP
+
+/* Maximum length of a value written with the "%.17g" fallback */
+const int FLOAT_FALLBACK_LEN = 32;
+
+/*
+ * How a floating point value is written.
+ *
+ * By default, it is the shortest text that reads back as the same double, in
+ * fixed notation: 1500 for a spindle speed of 1500 RPM, 12.345 for a
+ * position. A fixed number of decimals, or of significant digits, can be set
+ * instead. With significant digits, large or small values may use an exponent.
+ */
+class FloatFormat
+{
+public:
+  enum EMode {
+    eSHORTEST,
+    eDECIMALS,
+    eSIGNIFICANT
+  };
+
+protected:
+  EMode mMode;
+  int mDigits;
+
+public:
+  FloatFormat() : mMode(eSHORTEST), mDigits(0) { }
+
+  void setShortest() { mMode = eSHORTEST; mDigits = 0; }
+  void setDecimals(int aDecimals) { mMode = eDECIMALS; mDigits = aDecimals; }
+  void setSignificantDigits(int aDigits) { mMode = eSIGNIFICANT; mDigits = aDigits; }
+  EMode getMode() const { return mMode; }
+  int getDigits() const { return mDigits; }
+
+  /* Write the value in [aFirst, aLast). Returns the end of the text */
+  char *format(char *aFirst, char *aLast, double aValue) const;
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "histogram.hpp"
+
+ProcessStats gProcessStats;
+
+/* Position of the most significant bit, aValue > 0 */
+static inline int highestBit(unsigned long long aValue)
+{
+#ifdef WIN32
+  unsigned long index;
+  if (_BitScanReverse(&index, (unsigned long) (aValue >> 32)))
+    return (int) index + 32;
+  _BitScanReverse(&index, (unsigned long) aValue);
+  return (int) index;
+#else
+  return 63 - __builtin_clzll(aValue);
+#endif
+}
+
+Histogram::Histogram()
+  : mCount(0), mSum(0), mMin(~0ULL), mMax(0)
+{
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    mBuckets[i].store(0, std::memory_order_relaxed);
+}
+
+/* The values below 2^(SUB_BITS + 1) have their own bucket. Above, the
+ * bucket is given by the most significant bit and the SUB_BITS next ones */
+int Histogram::bucket(unsigned long long aValue)
+{
+  if (aValue < (2ULL << HISTOGRAM_SUB_BITS))
+    return (int) aValue;
+  int shift = highestBit(aValue) - HISTOGRAM_SUB_BITS;
+  return (shift << HISTOGRAM_SUB_BITS) + (int) (aValue >> shift);
+}
+
+unsigned long long Histogram::highestValue(int aBucket)
+{
+  if (aBucket < (2 << HISTOGRAM_SUB_BITS))
+    return (unsigned long long) aBucket;
+  int shift = (aBucket >> HISTOGRAM_SUB_BITS) - 1;
+  unsigned long long lowest = (unsigned long long) (aBucket - (shift << HISTOGRAM_SUB_BITS)) << shift;
+  return lowest + ((1ULL << shift) - 1);
+}
+
+void Histogram::record(unsigned long long aValue)
+{
+  mBuckets[bucket(aValue)].fetch_add(1, std::memory_order_relaxed);
+  mCount.fetch_add(1, std::memory_order_relaxed);
+  mSum.fetch_add(aValue, std::memory_order_relaxed);
+
+  unsigned long long current = mMin.load(std::memory_order_relaxed);
+  while (aValue < current &&
+         !mMin.compare_exchange_weak(current, aValue, std::memory_order_relaxed))
+    ;
+  current = mMax.load(std::memory_order_relaxed);
+  while (aValue > current &&
+         !mMax.compare_exchange_weak(current, aValue, std::memory_order_relaxed))
+    ;
+}
+
+unsigned long long Histogram::min()
+{
+  unsigned long long value = mMin.load(std::memory_order_relaxed);
+  return value == ~0ULL ? 0 : value;
+}
+
+double Histogram::mean()
+{
+  unsigned long long n = count();
+  return n == 0 ? 0.0 : (double) mSum.load(std::memory_order_relaxed) / n;
+}
+
+unsigned long long Histogram::percentile(double aPercent)
+{
+  unsigned long long n = count();
+  if (n == 0)
+    return 0;
+  unsigned long long rank = (unsigned long long) (aPercent / 100.0 * n + 0.5);
+  if (rank == 0)
+    rank = 1;
+
+  unsigned long long total = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+  {
+    total += mBuckets[i].load(std::memory_order_relaxed);
+    if (total >= rank)
+    {
+      unsigned long long value = highestValue(i);
+      unsigned long long highest = max();
+      return value < highest ? value : highest;
+    }
+  }
+  return max();
+}
+
+const char *CycleStats::name(EMetric aMetric)
+{
+  switch (aMetric)
+  {
+  case eCYCLE_TIME: return "cycle_ns";
+  case eENCODE_TIME: return "encode_ns";
+  case eSEND_TIME: return "send_ns";
+  case eBYTES: return "bytes";
+  case eLINES: return "lines";
+  case eCHANGES: return "changes";
+  default: return "";
+  }
+}
+
+int CycleStats::format(EMetric aMetric, char *aBuffer, int aMaxLen)
+{
+  Histogram &histogram = mHistograms[aMetric];
+  int len = snprintf(aBuffer, aMaxLen,
+    "%s count=%llu mean=%.0f min=%llu p50=%llu p90=%llu p99=%llu p999=%llu max=%llu",
+    name(aMetric), histogram.count(), histogram.mean(), histogram.min(),
+    histogram.percentile(50.0), histogram.percentile(90.0), histogram.percentile(99.0),
+    histogram.percentile(99.9), histogram.max());
+  if (len < 0 || len >= aMaxLen)
+    len = aMaxLen - 1;
+  return len;
+}
@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <stddef.h>
+#include <atomic>
+
+/* Some constants */
+const int HISTOGRAM_SUB_BITS = 4;   /* 16 buckets per power of two: 6% precision */
+const int HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;
+
+/*
+ * Distribution of a positive value, in log-linear buckets like an HDR
+ * histogram: the values below 32 are counted exactly, the others in 16
+ * buckets per power of two, so that the percentiles are given with a
+ * relative precision of 1/16 whatever the magnitude.
+ *
+ * Lock-free: record() may be called by any thread, while another one reads
+ * the statistics. A read is not an atomic snapshot, the counts of the
+ * records that are made at the same time may be partly taken.
+ */
+class Histogram
+{
+protected:
+  std::atomic<unsigned long long> mBuckets[HISTOGRAM_BUCKETS];
+  std::atomic<unsigned long long> mCount;
+  std::atomic<unsigned long long> mSum;
+  std::atomic<unsigned long long> mMin;
+  std::atomic<unsigned long long> mMax;
+
+protected:
+  static int bucket(unsigned long long aValue);
+  static unsigned long long highestValue(int aBucket);
+
+private:
+  Histogram(const Histogram &);
+  Histogram &operator=(const Histogram &);
+
+public:
+  Histogram();
+
+  void record(unsigned long long aValue);
+
+  unsigned long long count() { return mCount.load(std::memory_order_relaxed); }
+  unsigned long long sum() { return mSum.load(std::memory_order_relaxed); }
+  unsigned long long min();
+  unsigned long long max() { return mMax.load(std::memory_order_relaxed); }
+  double mean();
+  /* The highest value of the bucket where the percentile is (0-100) */
+  unsigned long long percentile(double aPercent);
+};
+
+/*
+ * The statistics of the cycles of an adapter: where the time goes in
+ * start() / finish(), and how much is sent.
+ */
+class CycleStats
+{
+public:
+  enum EMetric {
+    eCYCLE_TIME,   /* From start() to the end of finish(), ns */
+    eENCODE_TIME,  /* Encoding of the changed values, ns */
+    eSEND_TIME,    /* Publication of the encoded frame, ns */
+    eBYTES,        /* Bytes sent per cycle */
+    eLINES,        /* Lines sent per cycle */
+    eCHANGES,      /* Data values sent per cycle */
+    eNUM_METRICS
+  };
+
+protected:
+  Histogram mHistograms[eNUM_METRICS];
+
+public:
+  std::atomic<int> mDataValues;                /* Number of data values of the adapter */
+  std::atomic<unsigned long long> mHeldChanges; /* Changes held by a minimum interval or a window */
+  std::atomic<unsigned long long> mSuppressedChanges; /* New values dropped by a deadband */
+
+public:
+  CycleStats() : mDataValues(0), mHeldChanges(0), mSuppressedChanges(0) { }
+
+  void record(EMetric aMetric, unsigned long long aValue) { mHistograms[aMetric].record(aValue); }
+  Histogram &get(EMetric aMetric) { return mHistograms[aMetric]; }
+  static const char *name(EMetric aMetric);
+
+  /* "name count=... mean=... min=... p50=... p90=... p99=... max=...".
+   * Returns the length */
+  int format(EMetric aMetric, char *aBuffer, int aMaxLen);
+};
+
+/*
+ * Counters of the whole process, updated by any thread
+ */
+struct ProcessStats
+{
+  std::atomic<unsigned long long> mFrames;         /* Frames created */
+  std::atomic<unsigned long long> mFramesReleased; /* Frames freed */
+  std::atomic<unsigned long long> mFrameBytes;     /* Bytes of the frames created */
+  std::atomic<unsigned long long> mBufferGrowths;  /* Allocations of the string buffers */
+  std::atomic<unsigned long long> mTextAllocations; /* Allocations of the long text values */
+  std::atomic<unsigned long long> mCycles;         /* Cycles of all the adapters */
+
+  ProcessStats() : mFrames(0), mFramesReleased(0), mFrameBytes(0), mBufferGrowths(0),
+                   mTextAllocations(0), mCycles(0) { }
+};
+
+extern ProcessStats gProcessStats;
+
+#endif
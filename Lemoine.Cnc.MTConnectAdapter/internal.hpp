@@ -60,6 +60,9 @@ typedef unsigned int uint32_t;
 #define sleep(t) Sleep(t * 1000)
 #define usleep(t) Sleep(t / 1000)
 
+/* Did the last socket call fail because a non-blocking socket is not ready ? */
+#define SOCKET_WOULD_BLOCK (WSAGetLastError() == WSAEWOULDBLOCK)
+
 #else /* WIN32 */
 
 /* Unix specifc include files */
@@ -83,6 +86,9 @@ typedef struct sockaddr SOCKADDR;
 #define SOCKET int
 #define closesocket close
 
+/* Did the last socket call fail because a non-blocking socket is not ready ? */
+#define SOCKET_WOULD_BLOCK (errno == EAGAIN || errno == EWOULDBLOCK)
+
 #endif /* WIN32 */
 
 #include <stdio.h>
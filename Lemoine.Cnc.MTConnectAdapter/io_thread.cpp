@@ -0,0 +1,157 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "io_thread.hpp"
+#include "server.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+IoThread::IoThread(Poller::EMode aPollMode)
+  : mPoller(aPollMode)
+  , mRunning(false)
+{
+  if (!mNotifier.isValid() || !mPoller.add(mNotifier.socket(), &mNotifier))
+    gLogger->error("The I/O thread can't be notified, the data is sent every %d ms",
+                   IO_THREAD_TICK);
+}
+
+IoThread::~IoThread()
+{
+  stop();
+  mPoller.remove(mNotifier.socket());
+}
+
+bool IoThread::start()
+{
+  if (mRunning.load())
+    return true;
+
+  mRunning = true;
+  try {
+    mThread = std::thread(&IoThread::run, this);
+  }
+  catch (const std::system_error &e) {
+    gLogger->error("Failed to start the I/O thread: %s", e.what());
+    mRunning = false;
+    return false;
+  }
+  return true;
+}
+
+void IoThread::stop()
+{
+  if (!mRunning.load())
+    return;
+
+  mRunning = false;
+  wakeUp();
+  mThread.join();
+  /* What was requested in the meantime */
+  applyChanges();
+}
+
+void IoThread::attach(Server *aServer)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mAttaching.push_back(aServer);
+  }
+  if (mRunning.load())
+    wakeUp();
+  else
+    applyChanges();
+}
+
+void IoThread::detach(Server *aServer)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDetaching.push_back(aServer);
+  if (mRunning.load()) {
+    wakeUp();
+    while (std::find(mDetaching.begin(), mDetaching.end(), aServer) != mDetaching.end())
+      mApplied.wait(lock);
+  }
+  else {
+    lock.unlock();
+    applyChanges();
+  }
+}
+
+/* Apply the requested attachments and detachments.
+ * Called by the I/O thread, or by any thread when it is not running */
+void IoThread::applyChanges()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mAttaching.empty() && mDetaching.empty())
+    return;
+
+  for (size_t i = 0; i < mAttaching.size(); i++) {
+    Server *server = mAttaching[i];
+    if (std::find(mDetaching.begin(), mDetaching.end(), server) != mDetaching.end())
+      continue;
+    server->attach(&mPoller);
+    mServers.push_back(server);
+  }
+  mAttaching.clear();
+
+  for (size_t i = 0; i < mDetaching.size(); i++) {
+    std::vector<Server *>::iterator it = std::find(mServers.begin(), mServers.end(), mDetaching[i]);
+    if (it != mServers.end()) {
+      (*it)->detach();
+      mServers.erase(it);
+    }
+  }
+  mDetaching.clear();
+  mApplied.notify_all();
+}
+
+void IoThread::run()
+{
+  gLogger->info("I/O thread started");
+
+  while (mRunning.load()) {
+    applyChanges();
+    if (mPoller.dispatch(IO_THREAD_TICK) < 0) {
+      /* Do not spin on a persistent error */
+      std::this_thread::sleep_for(std::chrono::milliseconds(IO_THREAD_TICK));
+    }
+    for (size_t i = 0; i < mServers.size(); i++)
+      mServers[i]->process();
+  }
+
+  gLogger->info("I/O thread stopped");
+}
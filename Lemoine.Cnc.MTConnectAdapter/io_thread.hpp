@@ -0,0 +1,100 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef IO_THREAD_HPP
+#define IO_THREAD_HPP
+
+#include "poller.hpp"
+#include "notifier.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Server;
+
+/* Some constants */
+const int IO_THREAD_TICK = 100; /* Maximum time (ms) between two processings of the servers */
+
+/*
+ * A thread dedicated to the network I/O of some servers.
+ *
+ * It owns the poller the sockets of the servers are registered in, and
+ * processes the servers (accept, read, heartbeats, send) each time some
+ * sockets are ready, each time a server is notified that some data was
+ * published, and at least every IO_THREAD_TICK ms.
+ *
+ * The servers are attached and detached from any thread, the change is
+ * applied by the I/O thread itself.
+ */
+class IoThread
+{
+protected:
+  Poller mPoller;
+  Notifier mNotifier;
+  std::thread mThread;
+  std::atomic<bool> mRunning;
+  std::vector<Server *> mServers;    /* I/O thread only */
+
+  std::mutex mMutex;                 /* Protects the changes below */
+  std::condition_variable mApplied;
+  std::vector<Server *> mAttaching;
+  std::vector<Server *> mDetaching;
+
+protected:
+  void run();
+  void applyChanges();
+
+public:
+  IoThread(Poller::EMode aPollMode = Poller::eSELECT);
+  ~IoThread();
+
+  bool start();
+  void stop();
+  bool isRunning() { return mRunning.load(); }
+
+  /* Register the sockets of the server, and process it from now on */
+  void attach(Server *aServer);
+  /* Unregister the sockets of the server. Returns once done */
+  void detach(Server *aServer);
+
+  /* Any thread: process the servers as soon as possible */
+  void wakeUp() { mNotifier.notify(); }
+
+  Poller::EMode getPollMode() { return mPoller.getMode(); }
+};
+
+#endif
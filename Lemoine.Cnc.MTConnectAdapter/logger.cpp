@@ -34,6 +34,7 @@
 
 #include "internal.hpp"
 #include "logger.hpp"
+#include "timestamp.hpp"
 
 Logger *gLogger = NULL;
 
@@ -44,27 +45,15 @@ const char *Logger::format(char *aBuffer, int aLen, const char *aFormat, va_list
   return aBuffer;
 }
 
+/* Each thread that logs has its own cached clock */
+static thread_local TimestampFormatter sClock;
+
 const char *Logger::timestamp(char *aBuffer)
 {
-#ifdef WIN32
-  SYSTEMTIME st;
-  GetSystemTime(&st);
-  sprintf(aBuffer, "%4d-%02d-%02dT%02d:%02d:%02d.%04dZ", st.wYear, st.wMonth, st.wDay, st.wHour, 
-          st.wMinute, st.wSecond, st.wMilliseconds);
-#else
-  struct timeval tv;
-  struct timezone tz;
-
-  gettimeofday(&tv, &tz);
-
-  strftime(aBuffer, 64, "%Y-%m-%dT%H:%M:%S", gmtime(&tv.tv_sec));
-  sprintf(aBuffer + strlen(aBuffer), ".%06dZ", tv.tv_usec);
-#endif
-  
+  memcpy(aBuffer, sClock.now(), sClock.length() + 1);
   return aBuffer;
 }
 
-#pragma unmanaged // Following code explicitely not managed: avoid C4793 warnings
 void Logger::error(const char *aFormat, ...)
 {
   char buffer[LOGGER_BUFFER_SIZE];
@@ -110,4 +99,3 @@ void Logger::debug(const char *aFormat, ...)
   fprintf(stderr, "%s - Debug: %s\n", timestamp(ts), format(buffer, LOGGER_BUFFER_SIZE, aFormat, args));
   va_end(args);
 }
-#pragma managed // End of the unmanaged section
\ No newline at end of file
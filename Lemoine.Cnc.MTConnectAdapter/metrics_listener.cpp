@@ -0,0 +1,327 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#define _WINSOCK_DEPRECATED_NO_WARNINGS
+
+#include "internal.hpp"
+#include "metrics_listener.hpp"
+#include "server.hpp"
+#include "timestamp.hpp"
+#include "logger.hpp"
+
+/* Constants */
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+MetricsListener::Connection::Connection(SOCKET aSocket, unsigned long long aDeadline)
+  : mSocket(aSocket), mRequestLength(0), mSent(0), mResponding(false),
+    mReadable(true), mWritable(true), mDeadline(aDeadline)
+{
+}
+
+MetricsListener::Connection::~Connection()
+{
+  ::closesocket(mSocket);
+}
+
+void MetricsListener::Connection::onPoll(const Poller::Event &aEvent)
+{
+  if (aEvent.mReadable || aEvent.mError)
+    mReadable = true;
+  if (aEvent.mWritable || aEvent.mError)
+    mWritable = true;
+}
+
+MetricsListener::MetricsListener(int aPort)
+  : mPort(aPort), mPoller(0), mAcceptable(false), mNumConnections(0)
+{
+  SOCKADDR_IN t;
+
+#ifdef SOCK_CLOEXEC
+  mSocket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+#else
+  mSocket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#endif
+  if (mSocket == INVALID_SOCKET) {
+    gLogger->error("Error at socket() for the metrics.");
+    return;
+  }
+
+  t.sin_family = AF_INET;
+  t.sin_port = htons(aPort);
+  t.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  if (::bind(mSocket, (SOCKADDR *)&t, sizeof(t)) == SOCKET_ERROR ||
+      listen(mSocket, METRICS_MAX_CONNECTIONS) == SOCKET_ERROR) {
+    gLogger->error("Failed to listen for the metrics on port %d", aPort);
+    ::closesocket(mSocket);
+    mSocket = INVALID_SOCKET;
+    return;
+  }
+
+  /* Port 0 lets the system choose: keep the one it bound to */
+  socklen_t len = sizeof(t);
+  if (::getsockname(mSocket, (SOCKADDR *)&t, &len) == 0)
+    mPort = ntohs(t.sin_port);
+
+#ifdef WIN32
+  u_long nonBlocking = 1;
+  ioctlsocket(mSocket, FIONBIO, &nonBlocking);
+#else
+  fcntl(mSocket, F_SETFL, fcntl(mSocket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+  gLogger->info("Metrics served on port %d", mPort);
+}
+
+MetricsListener::~MetricsListener()
+{
+  detach();
+  for (int i = 0; i < mNumConnections; i++)
+    delete mConnections[i];
+  if (mSocket != INVALID_SOCKET)
+    ::closesocket(mSocket);
+}
+
+void MetricsListener::attach(Poller *aPoller)
+{
+  if (mSocket == INVALID_SOCKET)
+    return;
+  if (!aPoller->add(mSocket, this)) {
+    gLogger->error("Failed to poll the metrics socket on port %d", mPort);
+    return;
+  }
+  mPoller = aPoller;
+  mAcceptable = true;
+
+  for (int i = mNumConnections - 1; i >= 0; i--)
+  {
+    Connection *connection = mConnections[i];
+    if (!mPoller->add(connection->mSocket, connection))
+      removeConnection(i);
+    else {
+      connection->mReadable = true;
+      connection->mWritable = true;
+    }
+  }
+}
+
+void MetricsListener::detach()
+{
+  if (mPoller == 0)
+    return;
+
+  for (int i = 0; i < mNumConnections; i++)
+    mPoller->remove(mConnections[i]->mSocket);
+  mPoller->remove(mSocket);
+  mPoller = 0;
+}
+
+void MetricsListener::onPoll(const Poller::Event &)
+{
+  mAcceptable = true;
+}
+
+void MetricsListener::process(Server &aServer)
+{
+  if (mPoller == 0)
+    return;
+
+  if (mAcceptable)
+    acceptConnections();
+
+  unsigned long long now = getMonotonicMilliseconds();
+  for (int i = mNumConnections - 1; i >= 0; i--)
+  {
+    Connection *connection = mConnections[i];
+    if (!serve(connection, aServer) || now > connection->mDeadline)
+      removeConnection(i);
+  }
+}
+
+void MetricsListener::acceptConnections()
+{
+  for (;;)
+  {
+    SOCKADDR_IN addr;
+    socklen_t len = sizeof(addr);
+    SOCKET socket = ::accept(mSocket, (SOCKADDR *) &addr, &len);
+    if (socket == INVALID_SOCKET) {
+      mAcceptable = false;
+      if (!SOCKET_WOULD_BLOCK)
+        gLogger->error("Error at accept() for the metrics.");
+      return;
+    }
+
+    /* Too many scrapers at the same time */
+    if (mNumConnections >= METRICS_MAX_CONNECTIONS) {
+      gLogger->warning("Too many metrics connections, refusing %s", inet_ntoa(addr.sin_addr));
+      ::closesocket(socket);
+      continue;
+    }
+
+#ifdef WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(socket, FIONBIO, &nonBlocking);
+#else
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(socket, F_SETFD, FD_CLOEXEC);
+#endif
+
+    Connection *connection =
+      new Connection(socket, getMonotonicMilliseconds() + METRICS_TIMEOUT);
+    if (!mPoller->add(socket, connection)) {
+      delete connection;
+      continue;
+    }
+    mConnections[mNumConnections++] = connection;
+  }
+}
+
+void MetricsListener::removeConnection(int aIndex)
+{
+  Connection *connection = mConnections[aIndex];
+  if (mPoller != 0)
+    mPoller->remove(connection->mSocket);
+  delete connection;
+  mConnections[aIndex] = mConnections[--mNumConnections];
+}
+
+bool MetricsListener::serve(Connection *aConnection, Server &aServer)
+{
+  if (!aConnection->mResponding)
+  {
+    if (!aConnection->mReadable)
+      return true;
+    aConnection->mReadable = false;
+    if (!receive(aConnection))
+      return false;
+    if (!aConnection->mResponding)
+      return true;
+    respond(aConnection, aServer);
+  }
+
+  if (!aConnection->mWritable)
+    return true;
+
+  size_t length = aConnection->mResponse.length();
+  while (aConnection->mSent < length)
+  {
+    int len = ::send(aConnection->mSocket, aConnection->mResponse.c_str() + aConnection->mSent,
+                     (int) (length - aConnection->mSent), MSG_NOSIGNAL);
+    if (len < 0) {
+      if (!SOCKET_WOULD_BLOCK)
+        return false;
+      aConnection->mWritable = false;
+      mPoller->setWrite(aConnection->mSocket, true);
+      return true;
+    }
+    aConnection->mSent += len;
+  }
+  return false;
+}
+
+/* Read the request until the end of its header. Returns false if the
+ * connection was closed or failed */
+bool MetricsListener::receive(Connection *aConnection)
+{
+  for (;;)
+  {
+    size_t available = METRICS_REQUEST_SIZE - 1 - aConnection->mRequestLength;
+    if (available == 0) {
+      /* Too long: answered as a bad request */
+      aConnection->mResponding = true;
+      return true;
+    }
+    int len = ::recv(aConnection->mSocket, aConnection->mRequest + aConnection->mRequestLength,
+                     (int) available, 0);
+    if (len < 0)
+      return SOCKET_WOULD_BLOCK;
+    if (len == 0)
+      return false;
+
+    aConnection->mRequestLength += len;
+    aConnection->mRequest[aConnection->mRequestLength] = '\0';
+    if (strstr(aConnection->mRequest, "\r\n\r\n") != 0 ||
+        strstr(aConnection->mRequest, "\n\n") != 0) {
+      aConnection->mResponding = true;
+      return true;
+    }
+  }
+}
+
+/* Parse the request line, and prepare the response */
+void MetricsListener::respond(Connection *aConnection, Server &aServer)
+{
+  char *request = aConnection->mRequest;
+  const char *status = "400 Bad Request";
+  bool head = false, found = false;
+
+  char *method = request;
+  char *path = strchr(method, ' ');
+  if (path != 0)
+  {
+    *path++ = '\0';
+    char *end = path + strcspn(path, " ?\r\n");
+    *end = '\0';
+    head = strcmp(method, "HEAD") == 0;
+    if (strcmp(method, "GET") != 0 && !head)
+      status = "405 Method Not Allowed";
+    else if (strcmp(path, "/metrics") == 0 || strcmp(path, "/") == 0) {
+      status = "200 OK";
+      found = true;
+    }
+    else
+      status = "404 Not Found";
+  }
+
+  StringBuffer body;
+  if (found)
+    aServer.writeMetrics(body);
+  else
+    body.append(status).append('\n');
+
+  aConnection->mResponse.appendf(
+    "HTTP/1.1 %s\r\n"
+    "Content-Type: %s\r\n"
+    "Content-Length: %u\r\n"
+    "Connection: close\r\n"
+    "\r\n",
+    status, found ? "text/plain; version=0.0.4; charset=utf-8" : "text/plain",
+    (unsigned int) body.length());
+  if (!head)
+    aConnection->mResponse.append(body.c_str(), body.length());
+}
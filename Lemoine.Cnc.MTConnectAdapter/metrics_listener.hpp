@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef METRICS_LISTENER_HPP
+#define METRICS_LISTENER_HPP
+
+#include "poller.hpp"
+#include "string_buffer.hpp"
+
+class Server;
+
+/* Some constants */
+const int METRICS_MAX_CONNECTIONS = 4;
+const int METRICS_REQUEST_SIZE = 2048;       /* Longest request header */
+const unsigned int METRICS_TIMEOUT = 5000;   /* A scrape must be done in that time (ms) */
+
+/*
+ * A minimal HTTP listener that serves the metrics of a server, in the
+ * Prometheus text format, on GET /metrics.
+ *
+ * It is processed by the server, in the same thread and with the same
+ * poller, so that the metrics of the clients are read without any lock.
+ * Each connection gets a single response, then it is closed. A connection
+ * that does not complete its request in time is dropped, and the
+ * connections beyond METRICS_MAX_CONNECTIONS are refused: a scraper never
+ * delays the clients of the server.
+ */
+class MetricsListener : public PollHandler
+{
+protected:
+  struct Connection : public PollHandler {
+    SOCKET mSocket;
+    char mRequest[METRICS_REQUEST_SIZE];
+    size_t mRequestLength;
+    StringBuffer mResponse;
+    size_t mSent;         /* Bytes of the response that were sent */
+    bool mResponding;     /* The response is ready */
+    bool mReadable;
+    bool mWritable;
+    unsigned long long mDeadline;  /* ms */
+
+    Connection(SOCKET aSocket, unsigned long long aDeadline);
+    ~Connection();
+    virtual void onPoll(const Poller::Event &aEvent);
+  };
+
+  SOCKET mSocket;
+  int mPort;
+  Poller *mPoller;      /* 0 if not attached */
+  bool mAcceptable;
+  Connection *mConnections[METRICS_MAX_CONNECTIONS];
+  int mNumConnections;
+
+protected:
+  void acceptConnections();
+  /* Returns false once the connection can be closed */
+  bool serve(Connection *aConnection, Server &aServer);
+  bool receive(Connection *aConnection);
+  void respond(Connection *aConnection, Server &aServer);
+  void removeConnection(int aIndex);
+
+public:
+  /* Listen on the port. If it fails, isListening() is false */
+  MetricsListener(int aPort);
+  ~MetricsListener();
+
+  void attach(Poller *aPoller);   /* Register the sockets */
+  void detach();                  /* Unregister the sockets */
+  virtual void onPoll(const Poller::Event &aEvent);
+  /* Accept, read the requests and send the responses */
+  void process(Server &aServer);
+
+  bool isListening() { return mSocket != INVALID_SOCKET; }
+  int getPort() { return mPort; }
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "notifier.hpp"
+#include "logger.hpp"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#define HAVE_EVENTFD 1
+#endif
+
+Notifier::Notifier()
+  : mReadSocket(INVALID_SOCKET)
+  , mWriteSocket(INVALID_SOCKET)
+  , mPending(false)
+{
+#if defined(HAVE_EVENTFD)
+  mReadSocket = mWriteSocket = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (mReadSocket < 0) {
+    gLogger->error("Error at eventfd(): %s", strerror(errno));
+    mReadSocket = mWriteSocket = INVALID_SOCKET;
+  }
+#elif defined(WIN32)
+  /* A UDP socket that sends to itself, since only sockets can be polled */
+  WSADATA w;
+  WSAStartup(MAKEWORD(2, 2), &w);
+  SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  SOCKADDR_IN addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (s == INVALID_SOCKET
+      || ::bind(s, (SOCKADDR *) &addr, sizeof(addr)) == SOCKET_ERROR
+      || ::getsockname(s, (SOCKADDR *) &addr, &len) == SOCKET_ERROR
+      || ::connect(s, (SOCKADDR *) &addr, sizeof(addr)) == SOCKET_ERROR) {
+    gLogger->error("Failed to create the notification socket");
+    if (s != INVALID_SOCKET)
+      ::closesocket(s);
+    return;
+  }
+  u_long nonBlocking = 1;
+  ioctlsocket(s, FIONBIO, &nonBlocking);
+  mReadSocket = mWriteSocket = s;
+#else
+  int fds[2];
+  if (::pipe(fds) != 0) {
+    gLogger->error("Error at pipe(): %s", strerror(errno));
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  mReadSocket = fds[0];
+  mWriteSocket = fds[1];
+#endif
+}
+
+Notifier::~Notifier()
+{
+  if (mReadSocket == INVALID_SOCKET)
+    return;
+  ::closesocket(mReadSocket);
+  if (mWriteSocket != mReadSocket)
+    ::closesocket(mWriteSocket);
+#ifdef WIN32
+  WSACleanup();
+#endif
+}
+
+void Notifier::notify()
+{
+  if (mPending.exchange(true))
+    return;
+
+#if defined(HAVE_EVENTFD)
+  uint64_t one = 1;
+  ssize_t res = ::write(mWriteSocket, &one, sizeof(one));
+  (void) res;
+#elif defined(WIN32)
+  char one = 1;
+  ::send(mWriteSocket, &one, 1, 0);
+#else
+  char one = 1;
+  ssize_t res = ::write(mWriteSocket, &one, 1);
+  (void) res;
+#endif
+}
+
+void Notifier::clear()
+{
+  char buffer[64];
+#ifdef WIN32
+  while (::recv(mReadSocket, buffer, sizeof(buffer), 0) > 0)
+    ;
+#else
+  while (::read(mReadSocket, buffer, sizeof(buffer)) > 0)
+    ;
+#endif
+
+  /* Reset the flag once drained: what was notified before is processed by
+   * the caller right after, what is notified after writes again */
+  mPending.store(false);
+}
@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "poller.hpp"
+#include "logger.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#define HAVE_EPOLL 1
+#endif
+
+Poller::Poller(EMode aMode)
+{
+  mMode = eSELECT;
+  mEpoll = -1;
+
+  if (aMode == eEPOLL) {
+#ifdef HAVE_EPOLL
+    mEpoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (mEpoll >= 0)
+      mMode = eEPOLL;
+    else
+      gLogger->error("Error at epoll_create1(): %s, fall back to select", strerror(errno));
+#else
+    gLogger->warning("epoll is not supported on this platform, fall back to select");
+#endif
+  }
+}
+
+Poller::~Poller()
+{
+#ifdef HAVE_EPOLL
+  if (mEpoll >= 0)
+    ::close(mEpoll);
+#endif
+}
+
+bool Poller::add(SOCKET aSocket, PollHandler *aHandler)
+{
+#ifdef HAVE_EPOLL
+  if (mMode == eEPOLL) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = aHandler;
+    if (::epoll_ctl(mEpoll, EPOLL_CTL_ADD, aSocket, &event) != 0) {
+      gLogger->error("Error at epoll_ctl(): %s", strerror(errno));
+      return false;
+    }
+    return true;
+  }
+#endif
+
+#ifdef WIN32
+  /* A Windows fd_set is an array of sockets */
+  if (mRegistrations.size() >= FD_SETSIZE) {
+    gLogger->error("Too many sockets for select(), limit is %d", (int) FD_SETSIZE);
+    return false;
+  }
+#else
+  /* A POSIX fd_set is a bitmap indexed by the descriptor */
+  if (aSocket < 0 || aSocket >= FD_SETSIZE) {
+    gLogger->error("Socket %d cannot be used with select(), limit is %d",
+                   (int) aSocket, (int) FD_SETSIZE);
+    return false;
+  }
+#endif
+  Registration registration;
+  registration.mSocket = aSocket;
+  registration.mHandler = aHandler;
+  registration.mWrite = false;
+  mRegistrations.push_back(registration);
+  return true;
+}
+
+void Poller::remove(SOCKET aSocket)
+{
+#ifdef HAVE_EPOLL
+  if (mMode == eEPOLL) {
+    ::epoll_ctl(mEpoll, EPOLL_CTL_DEL, aSocket, 0);
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < mRegistrations.size(); i++) {
+    if (mRegistrations[i].mSocket == aSocket) {
+      mRegistrations.erase(mRegistrations.begin() + i);
+      return;
+    }
+  }
+}
+
+void Poller::setWrite(SOCKET aSocket, bool aWrite)
+{
+  if (mMode == eEPOLL)
+    return;
+
+  for (size_t i = 0; i < mRegistrations.size(); i++) {
+    if (mRegistrations[i].mSocket == aSocket) {
+      mRegistrations[i].mWrite = aWrite;
+      return;
+    }
+  }
+}
+
+int Poller::wait(Event *aEvents, int aMaxEvents, int aTimeout)
+{
+#ifdef HAVE_EPOLL
+  if (mMode == eEPOLL) {
+    struct epoll_event events[64];
+    int max = aMaxEvents < 64 ? aMaxEvents : 64;
+    int n = ::epoll_wait(mEpoll, events, max, aTimeout);
+    if (n < 0) {
+      if (errno == EINTR)
+        return 0;
+      gLogger->error("Error at epoll_wait(): %s", strerror(errno));
+      return -1;
+    }
+    for (int i = 0; i < n; i++) {
+      aEvents[i].mHandler = (PollHandler *) events[i].data.ptr;
+      aEvents[i].mReadable = (events[i].events & (EPOLLIN | EPOLLRDHUP)) != 0;
+      aEvents[i].mWritable = (events[i].events & EPOLLOUT) != 0;
+      aEvents[i].mError = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+    }
+    return n;
+  }
+#endif
+
+  if (mRegistrations.empty())
+    return 0;
+
+  fd_set rset, wset;
+  FD_ZERO(&rset);
+  FD_ZERO(&wset);
+  bool write = false;
+  int nfds = 0;
+  for (size_t i = 0; i < mRegistrations.size(); i++)
+  {
+    SOCKET socket = mRegistrations[i].mSocket;
+    FD_SET(socket, &rset);
+    if (mRegistrations[i].mWrite) {
+      FD_SET(socket, &wset);
+      write = true;
+    }
+#ifndef WIN32
+    if (socket > nfds)
+      nfds = socket;
+#endif
+  }
+#ifdef WIN32
+  nfds = (int) mRegistrations.size();
+#else
+  nfds++;
+#endif
+
+  struct timeval timeout;
+  timeout.tv_sec = aTimeout / 1000;
+  timeout.tv_usec = (aTimeout % 1000) * 1000;
+
+  int n = ::select(nfds, &rset, write ? &wset : 0, 0, &timeout);
+  if (n <= 0)
+    return n;
+
+  int count = 0;
+  for (size_t i = 0; i < mRegistrations.size() && count < aMaxEvents; i++)
+  {
+    SOCKET socket = mRegistrations[i].mSocket;
+    bool readable = FD_ISSET(socket, &rset) != 0;
+    bool writable = write && FD_ISSET(socket, &wset) != 0;
+    if (readable || writable)
+    {
+      aEvents[count].mHandler = mRegistrations[i].mHandler;
+      aEvents[count].mReadable = readable;
+      aEvents[count].mWritable = writable;
+      aEvents[count].mError = false;
+      count++;
+    }
+  }
+  return count;
+}
+
+int Poller::dispatch(int aTimeout)
+{
+  const int maxEvents = 64;
+  Event events[maxEvents];
+  int total = 0;
+  int n;
+  do {
+    n = wait(events, maxEvents, aTimeout);
+    if (n < 0)
+      return -1;
+    for (int i = 0; i < n; i++)
+      events[i].mHandler->onPoll(events[i]);
+    total += n;
+    aTimeout = 0;
+  } while (n == maxEvents);
+  return total;
+}
@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef POLLER_HPP
+#define POLLER_HPP
+
+#include <vector>
+
+class PollHandler;
+
+/*
+ * Readiness notification for a set of sockets.
+ *
+ * The sockets are registered once, with the handler their events are
+ * dispatched to. Two implementations are available:
+ * - eSELECT: portable, level-triggered, limited to FD_SETSIZE sockets.
+ *   The writability is only checked for the sockets that were set with
+ *   setWrite(),
+ * - eEPOLL: Linux only, edge-triggered. A readable socket must be read
+ *   (and a writable socket written) until it would block, else no new event
+ *   is returned for it.
+ *
+ * eEPOLL falls back to eSELECT on the platforms that do not support it.
+ *
+ * A poller is not thread-safe: it must be used by a single thread.
+ */
+class Poller
+{
+public:
+  enum EMode {
+    eSELECT,
+    eEPOLL
+  };
+
+  struct Event {
+    PollHandler *mHandler;
+    bool mReadable;
+    bool mWritable;
+    bool mError;
+  };
+
+protected:
+  struct Registration {
+    SOCKET mSocket;
+    PollHandler *mHandler;
+    bool mWrite;
+  };
+
+  EMode mMode;
+  int mEpoll;                               /* epoll file descriptor */
+  std::vector<Registration> mRegistrations; /* select: the registered sockets */
+
+public:
+  Poller(EMode aMode = eSELECT);
+  ~Poller();
+
+  EMode getMode() { return mMode; }
+
+  bool add(SOCKET aSocket, PollHandler *aHandler);
+  void remove(SOCKET aSocket);
+  /* Check the writability of the socket (select only, no-op for epoll) */
+  void setWrite(SOCKET aSocket, bool aWrite);
+
+  /* Wait at most aTimeout ms (0: do not wait) for some events.
+   * Returns the number of events that were written in aEvents, -1 in case of error */
+  int wait(Event *aEvents, int aMaxEvents, int aTimeout);
+
+  /* Wait at most aTimeout ms for some events, and pass all of them to their handler.
+   * Returns the number of events, -1 in case of error */
+  int dispatch(int aTimeout);
+};
+
+/*
+ * An object that owns a socket registered in a poller.
+ *
+ * The handler is called from the thread of the poller, right after the
+ * wait: it should only record the readiness of the socket, not process it.
+ */
+class PollHandler
+{
+public:
+  virtual ~PollHandler() { }
+  virtual void onPoll(const Poller::Event &aEvent) = 0;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "pulse_device.hpp"
+#include "adapter_core.hpp"
+#include "device_datum.hpp"
+
+/* The names of the samples, in the order of EPulseSample */
+static const char *sSampleNames[ePULSE_NUM_SAMPLES] = {
+  "Xact",
+  "Yact",
+  "Zact",
+  "Uact",
+  "Vact",
+  "Wact",
+  "Apos",
+  "Bpos",
+  "Cpos",
+  "path_feedrate",
+  "spindle_load",
+  "spindle_speed",
+  "feed_ovr",
+  "SspeedOvr"
+};
+
+PulseDevice::PulseDevice(AdapterCore &aCore)
+  : mCore(aCore)
+  , mAvailability(0)
+  , mExecution(0)
+  , mMode(0)
+  , mProgramName(0)
+{
+  for (int i = 0; i < ePULSE_NUM_SAMPLES; i++)
+    mSamples[i] = 0;
+}
+
+PulseDevice::~PulseDevice()
+{
+  delete mAvailability;
+  delete mExecution;
+  delete mMode;
+  delete mProgramName;
+  for (int i = 0; i < ePULSE_NUM_SAMPLES; i++)
+    delete mSamples[i];
+}
+
+Availability *PulseDevice::availability()
+{
+  if (mAvailability == 0) {
+    mAvailability = new Availability("avail");
+    mCore.addDatum(*mAvailability);
+  }
+  return mAvailability;
+}
+
+void PulseDevice::setAvailable(bool aAvailable)
+{
+  if (aAvailable)
+    availability()->available();
+  else
+    availability()->unavailable();
+}
+
+void PulseDevice::apply(PulseData &aData)
+{
+  unsigned int set = aData.mSet;
+  if (set == 0)
+    return;
+
+  for (int i = 0; i < ePULSE_NUM_SAMPLES; i++)
+  {
+    if ((set & (1u << i)) == 0)
+      continue;
+    if (mSamples[i] == 0) {
+      mSamples[i] = new Sample(sSampleNames[i]);
+      mCore.addDatum(*mSamples[i]);
+    }
+    mSamples[i]->setValue(aData.mSamples[i]);
+  }
+
+  if (set & PULSE_MANUAL) {
+    if (mMode == 0) {
+      mMode = new ControllerMode("mode");
+      mCore.addDatum(*mMode);
+    }
+    mMode->setValue(aData.mManual ? ControllerMode::eMANUAL : ControllerMode::eAUTOMATIC);
+  }
+
+  if (set & PULSE_RUNNING) {
+    if (mExecution == 0) {
+      mExecution = new Execution("execution");
+      mCore.addDatum(*mExecution);
+    }
+    mExecution->setValue(aData.mRunning ? Execution::eACTIVE : Execution::eINTERRUPTED);
+  }
+
+  if (set & PULSE_PROGRAM_NAME) {
+    if (mProgramName == 0) {
+      mProgramName = new Event("program");
+      mCore.addDatum(*mProgramName);
+    }
+    mProgramName->setValue(aData.mProgramName);
+  }
+
+  availability()->available();
+  aData.mSet = 0;
+}
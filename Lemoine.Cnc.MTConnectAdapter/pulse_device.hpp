@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef PULSE_DEVICE_HPP
+#define PULSE_DEVICE_HPP
+
+/* Forward class definitions */
+class AdapterCore;
+class Availability;
+class Execution;
+class ControllerMode;
+class Event;
+class Sample;
+
+/* The samples of a PULSE CNC */
+enum EPulseSample {
+  ePULSE_X,
+  ePULSE_Y,
+  ePULSE_Z,
+  ePULSE_U,
+  ePULSE_V,
+  ePULSE_W,
+  ePULSE_A,
+  ePULSE_B,
+  ePULSE_C,
+  ePULSE_FEEDRATE,
+  ePULSE_SPINDLE_LOAD,
+  ePULSE_SPINDLE_SPEED,
+  ePULSE_FEEDRATE_OVERRIDE,
+  ePULSE_SPINDLE_SPEED_OVERRIDE,
+  ePULSE_NUM_SAMPLES
+};
+
+/* The other values, as flags after the ones of the samples */
+const unsigned int PULSE_MANUAL = 1u << ePULSE_NUM_SAMPLES;
+const unsigned int PULSE_RUNNING = PULSE_MANUAL << 1;
+const unsigned int PULSE_PROGRAM_NAME = PULSE_RUNNING << 1;
+const unsigned int PULSE_AVAILABLE = PULSE_PROGRAM_NAME << 1;  /* Even if no value was set */
+
+const int PULSE_PROGRAM_NAME_LEN = 512;
+
+/*
+ * The values of a PULSE CNC that were set during a cycle, as a flat
+ * structure, applied at once with PulseDevice::apply().
+ *
+ * Bit i of mSet is set if mSamples[i] was set, and the PULSE_xxx flags
+ * tell which other values were set.
+ */
+struct PulseData
+{
+  unsigned int mSet;
+  double mSamples[ePULSE_NUM_SAMPLES];
+  bool mManual;
+  bool mRunning;
+  char mProgramName[PULSE_PROGRAM_NAME_LEN];
+
+  PulseData() : mSet(0) { mProgramName[0] = '\0'; }
+
+  void setSample(EPulseSample aSample, double aValue)
+  {
+    mSamples[aSample] = aValue;
+    mSet |= 1u << aSample;
+  }
+};
+
+/*
+ * The data values of a PULSE CNC. They are only created and added to the
+ * adapter once they are first set, so that a CNC only publishes the
+ * values it provides.
+ */
+class PulseDevice
+{
+protected:
+  AdapterCore &mCore;
+  Availability *mAvailability;
+  Execution *mExecution;
+  ControllerMode *mMode;
+  Event *mProgramName;
+  Sample *mSamples[ePULSE_NUM_SAMPLES];
+
+protected:
+  Availability *availability();
+
+public:
+  PulseDevice(AdapterCore &aCore);
+  virtual ~PulseDevice();
+
+  /* Set the values of aData, and flag the CNC as available if any was set.
+   * aData is cleared */
+  void apply(PulseData &aData);
+  void setAvailable(bool aAvailable);
+};
+
+#endif
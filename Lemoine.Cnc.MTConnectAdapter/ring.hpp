@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <stddef.h>
+#include <atomic>
+
+/*
+ * Bounded single-producer / single-consumer lock-free queue.
+ *
+ * One thread only calls push(), one other thread only calls pop(). The
+ * capacity is rounded up to a power of two. The head and the tail are kept
+ * on different cache lines, so that the two threads do not share one.
+ */
+template <typename T>
+class SpscRing
+{
+protected:
+  enum { CACHE_LINE = 64 };
+
+  T *mItems;
+  size_t mMask;
+  char mPad0[CACHE_LINE];
+  std::atomic<size_t> mHead;  /* Next position to pop, written by the consumer */
+  char mPad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> mTail;  /* Next position to push, written by the producer */
+  char mPad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+
+private:
+  SpscRing(const SpscRing &);
+  SpscRing &operator=(const SpscRing &);
+
+public:
+  SpscRing(size_t aCapacity)
+    : mHead(0), mTail(0)
+  {
+    size_t size = 1;
+    while (size < aCapacity)
+      size <<= 1;
+    mItems = new T[size];
+    mMask = size - 1;
+  }
+  ~SpscRing() { delete[] mItems; }
+
+  /* Producer side. Returns false if the ring is full */
+  bool push(const T &aItem)
+  {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mHead.load(std::memory_order_acquire) > mMask)
+      return false;
+    mItems[tail & mMask] = aItem;
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* Consumer side. Returns false if the ring is empty */
+  bool pop(T &aItem)
+  {
+    size_t head = mHead.load(std::memory_order_relaxed);
+    if (head == mTail.load(std::memory_order_acquire))
+      return false;
+    aItem = mItems[head & mMask];
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const { return mMask + 1; }
+  /* Number of items in the ring. From either side, the other one may change it */
+  size_t size() const
+  {
+    return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+  }
+};
+
+#endif
@@ -37,18 +37,68 @@
 #include "internal.hpp"
 #include "server.hpp"
 #include "client.hpp"
+#include "frame.hpp"
+#include "io_thread.hpp"
+#include "metrics_listener.hpp"
+#include "string_buffer.hpp"
+#include "timestamp.hpp"
 #include "logger.hpp"
 
 /* Constants */
-const int READ_BUFFER_LEN = 8092;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 /* Create the server and bind to the port */
-Server::Server(int aPort, int aHeartbeatFreq)
+Server::Server(int aPort, int aHeartbeatFreq, Poller::EMode aPollMode,
+               const ServerSettings &aSettings)
+  : mPoller(0)
+  , mOwnedPoller(new Poller(aPollMode))
+  , mIoThread(0)
 {
+  init(aPort, aHeartbeatFreq, aSettings);
+  attach(mOwnedPoller);
+  if (mPoller == 0) {
+    gLogger->error("Failed to poll the socket on port %d", mPort);
+    delete this;
+    exit(1);
+  }
+}
 
+/* Create the server, bind to the port, and let the I/O thread process it */
+Server::Server(int aPort, int aHeartbeatFreq, IoThread *aIoThread,
+               const ServerSettings &aSettings)
+  : mPoller(0)
+  , mOwnedPoller(0)
+  , mIoThread(aIoThread)
+{
+  init(aPort, aHeartbeatFreq, aSettings);
+  mIoThread->attach(this);
+}
+
+void Server::init(int aPort, int aHeartbeatFreq, const ServerSettings &aSettings)
+{
   mNumClients = 0;
+  mClientCount = 0;
+  mNextClientId = 1;
+  mAcceptable = false;
   mPort = aPort;
+  mSettings = aSettings;
+  if (mSettings.mReservedSlots > MAX_CLIENTS)
+    mSettings.mReservedSlots = MAX_CLIENTS;
+  mPong = 0;
+  mMetrics = 0;
   mTimeout = aHeartbeatFreq * 2;
+  mMaxQueue = DEFAULT_MAX_QUEUE;
+  for (int i = 0; i < MAX_CHANNELS; i++)
+    mChannels[i] = 0;
+  mNumChannels = 0;
+  mAccepted = mRejected = 0;
+  for (int i = 0; i < eNUM_DISCONNECTS; i++)
+    mDisconnects[i] = 0;
+  if (!mSettings.mShared)
+    openChannel();
 
   SOCKADDR_IN t;
 
@@ -64,7 +114,11 @@ Server::Server(int aPort, int aHeartbeatFreq)
   }
 #endif
 
+#ifdef SOCK_CLOEXEC
+  mSocket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+#else
   mSocket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#endif
 
   if (mSocket == INVALID_SOCKET) {
     gLogger->error("Error at socket().", stderr);
@@ -82,166 +136,762 @@ Server::Server(int aPort, int aHeartbeatFreq)
     exit(1);
   }
 
-  if (listen(mSocket, 4) == SOCKET_ERROR) {
+  /* Port 0 lets the system choose: keep the one it bound to */
+  socklen_t len = sizeof(t);
+  if (::getsockname(mSocket, (SOCKADDR *)&t, &len) == 0)
+    mPort = ntohs(t.sin_port);
+
+  if (listen(mSocket, mSettings.mBacklog) == SOCKET_ERROR) {
     gLogger->error("Error listening.");
     delete this;
     exit(1);
   }
 
+  /* accept() is called until it would block */
+#ifdef WIN32
+  u_long nonBlocking = 1;
+  ioctlsocket(mSocket, FIONBIO, &nonBlocking);
+#else
+  fcntl(mSocket, F_SETFL, fcntl(mSocket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
   // Default to a 10 second heartbeat
-  sprintf(mPong, "* PONG %d\n", aHeartbeatFreq);
+  char pong[32];
+  sprintf(pong, "* PONG %d\n", aHeartbeatFreq);
+  mPong = Frame::create(pong, strlen(pong));
+  mCommands.add("PING", this);
+  mCommands.add("stats", &mStatsCommand);
+
+  if (mSettings.mMetricsPort >= 0) {
+    mMetrics = new MetricsListener(mSettings.mMetricsPort);
+    if (!mMetrics->isListening()) {
+      delete mMetrics;
+      mMetrics = 0;
+    }
+  }
 
-  gLogger->info("Server started, waiting on port %d", aPort);
+  gLogger->info("Server started, waiting on port %d", mPort);
 }
 
 Server::~Server()
 {
+  if (mIoThread != 0)
+    mIoThread->detach(this);
+  else
+    detach();
+
   for (int i = 0; i < mNumClients; i++)
   {
     Client *client = mClients[i];
     delete client;
   }
 
+  /* What the I/O thread did not send */
+  for (int i = 0; i < channelCount(); i++)
+  {
+    Channel *channel = mChannels[i];
+    if (channel == 0)
+      continue;
+    Publication publication;
+    while (channel->mOutbox.pop(publication))
+      publication.mFrame->release();
+    delete channel;
+  }
+
+  delete mMetrics;
   ::shutdown(mSocket, SHUT_RDWR);
+  ::closesocket(mSocket);
+  if (mPong != 0)
+    mPong->release();
+  delete mOwnedPoller;
 
 #ifdef WINDOWS
   WSACleanup();
 #endif
 }
 
-void Server::readFromClients()
+int Server::getMetricsPort()
+{
+  return mMetrics != 0 ? mMetrics->getPort() : 0;
+}
+
+Poller::EMode Server::getPollMode()
+{
+  if (mIoThread != 0)
+    return mIoThread->getPollMode();
+  else
+    return mOwnedPoller->getMode();
+}
+
+/* Register the listening socket and the clients in the poller */
+void Server::attach(Poller *aPoller)
 {
-  fd_set rset;
-  FD_ZERO(&rset);
-  int nfds = 0;
+  if (!aPoller->add(mSocket, this)) {
+    gLogger->error("Failed to poll the socket on port %d", mPort);
+    return;
+  }
+  mPoller = aPoller;
+  /* What was missed while not registered */
+  mAcceptable = true;
+  if (mMetrics != 0)
+    mMetrics->attach(aPoller);
+
+  for (int i = mNumClients - 1; i >= 0; i--)
+  {
+    Client *client = mClients[i];
+    client->mPollWrite = false;
+    if (!mPoller->add(client->socket(), client))
+      removeClient(client, eDISCONNECT_ERROR);
+    else {
+      client->mReadable = true;
+      updateWriteInterest(client);
+    }
+  }
+}
+
+void Server::detach()
+{
+  if (mPoller == 0)
+    return;
+
   for (int i = 0; i < mNumClients; i++)
+    mPoller->remove(mClients[i]->socket());
+  if (mMetrics != 0)
+    mMetrics->detach();
+  mPoller->remove(mSocket);
+  mPoller = 0;
+}
+
+/* The listening socket is ready */
+void Server::onPoll(const Poller::Event &)
+{
+  mAcceptable = true;
+}
+
+void Server::process()
+{
+  if (mPoller == 0)
+    return;
+
+  /* Without I/O thread, poll the sockets now, without waiting */
+  if (mIoThread == 0)
+    mPoller->dispatch(0);
+
+  bool overrun = false;
+  int numChannels = channelCount();
+  for (int i = 0; i < numChannels; i++)
+  {
+    Channel *channel = mChannels[i].load(std::memory_order_acquire);
+    if (channel != 0 && channel->mOverrun.exchange(false))
+      overrun = true;
+  }
+  if (overrun) {
+    gLogger->warning("The I/O thread did not keep up with the published data, "
+                     "disconnecting the clients");
+    for (int i = mNumClients - 1; i >= 0; i--)
+      removeClient(mClients[i], eDISCONNECT_OVERRUN);
+  }
+
+  flushClients();
+  acceptClients();
+  readFromClients();
+  checkHeartbeats();
+  drainOutbox();
+  if (mMetrics != 0)
+    mMetrics->process(*this);
+}
+
+/* Send the queued data of the clients that are writable again */
+void Server::flushClients()
+{
+  for (int i = mNumClients - 1; i >= 0; i--)
   {
     Client *client = mClients[i];
-    FD_SET(client->socket(), &rset);
-#ifndef WIN32
-    if (client->socket() > nfds)
-      nfds = client->socket();
-#endif
+    if (client->queued() > 0 && client->mWritable)
+    {
+      if (client->flush() < 0)
+        removeClient(client, eDISCONNECT_ERROR);
+      else
+        updateWriteInterest(client);
+    }
   }
-#ifdef WIN32
-  nfds = mNumClients;
-#else
-  nfds++;
-#endif
+}
+
+/* With select, only poll the writability of the clients that have some queued data */
+void Server::updateWriteInterest(Client *aClient)
+{
+  bool write = aClient->queued() > 0;
+  if (write != aClient->mPollWrite && mPoller != 0)
+  {
+    mPoller->setWrite(aClient->socket(), write);
+    aClient->mPollWrite = write;
+  }
+}
+
+void Server::readFromClients()
+{
+  bool edge = (mPoller->getMode() == Poller::eEPOLL);
+  int len;
 
-  struct timeval timeout;
-  ::memset(&timeout, 0, sizeof(timeout));
+  /* Since clients can be removed, we need to iterate backwards */
+  for (int i = mNumClients - 1; i >= 0; i--)
+  {
+    Client *client = mClients[i];
+    if (!client->mReadable)
+      continue;
+    client->mReadable = false;
+
+    /* Edge-triggered: read everything that is available */
+    bool error = false;
+    do {
+      len = client->receive();
+      if (len > 0)
+        error = !dispatch(client);
+    } while (edge && len > 0 && !error);
+
+    if (error)
+      continue;
+    if (len < 0 && SOCKET_WOULD_BLOCK)
+      continue;
+    if (len <= 0)
+      removeClient(client, len == 0 ? eDISCONNECT_CLOSED : eDISCONNECT_ERROR);
+  }
+}
 
-  if (::select(nfds, &rset, 0, 0, &timeout) > 0)
+/* Handle the complete lines a client sent. Returns false if it was removed */
+bool Server::dispatch(Client *aClient)
+{
+  char *line;
+  while (aClient->nextLine(line))
   {
-    char buffer[READ_BUFFER_LEN];
-    int len;
+    if (line[0] != '*' || line[1] != ' ')
+      continue;
+
+    const char *arguments;
+    CommandHandler *handler = mCommands.find(line + 2, arguments);
+    if (handler == 0)
+      gLogger->debug("Unknown command: %s", line);
+    else if (!handler->onCommand(*this, aClient, arguments))
+      return false;
+  }
+  return true;
+}
+
+bool Server::onCommand(Server &, Client *aClient, const char *)
+{
+  unsigned long long now = getMonotonicMilliseconds();
+  if (aClient->mLastPing != 0)
+    aClient->mPingInterval = (unsigned int) (now - aClient->mLastPing);
+  aClient->mLastPing = now;
+  mTimers.schedule(&aClient->mHeartbeat, now + mTimeout);
+  return sendToClient(aClient, mPong);
+}
 
-    /* Since clients can be removed, we need to iterate backwards */
+/* Disconnect the clients that stopped sending PING */
+void Server::checkHeartbeats()
+{
+  if (mTimers.empty())
+    return;
+
+  unsigned long long now = getMonotonicMilliseconds();
+  Timer *timer;
+  while ((timer = mTimers.nextExpired(now)) != 0)
+  {
+    gLogger->warning("Client has not sent heartbeat in over %d ms, disconnecting",
+      mTimeout);
+    removeClient((Client *) timer->getOwner(), eDISCONNECT_HEARTBEAT);
+  }
+}
+
+/* Send what the acquisition thread published, and free the channels that
+ * were closed once they are drained */
+void Server::drainOutbox()
+{
+  int numChannels = channelCount();
+  for (int i = 0; i < numChannels; i++)
+  {
+    Channel *channel = mChannels[i].load(std::memory_order_acquire);
+    if (channel == 0)
+      continue;
+    /* Once closed, the publisher does not push anymore */
+    bool closed = !channel->mOpen.load(std::memory_order_acquire);
+    Publication publication;
+    while (channel->mOutbox.pop(publication))
+    {
+      send(publication.mFrame, publication.mClient);
+      publication.mFrame->release();
+    }
+    if (closed) {
+      mChannels[i].store(0, std::memory_order_release);
+      delete channel;
+    }
+  }
+}
+
+/* Send a published frame: to the clients that got their initial data, or to a single client */
+void Server::send(Frame *aFrame, ClientId aClient)
+{
+  if (aClient == 0)
+  {
     for (int i = mNumClients - 1; i >= 0; i--)
+    {
+      if (mClients[i]->mInitialized)
+        sendToClient(mClients[i], aFrame);
+    }
+  }
+  else
+  {
+    Client *client = findClient(aClient);
+    if (client != 0)
+    {
+      /* An empty initial frame only makes the client get the next changes */
+      client->mInitialized = true;
+      if (aFrame->length() > 0)
+        sendToClient(client, aFrame);
+    }
+  }
+}
+
+Server::Channel::Channel(const char *aName)
+  : mOutbox(OUTBOX_SIZE), mNewClients(MAX_CLIENTS * 2),
+    mOverrun(false), mOpen(true)
+{
+  strncpy(mName, aName, CHANNEL_NAME_LEN);
+  mName[CHANNEL_NAME_LEN - 1] = '\0';
+}
+
+/* Take the first free slot: the slots of the closed channels are freed by
+ * the I/O side, and reused */
+int Server::openChannel(const char *aName)
+{
+  Channel *channel = new Channel(aName);
+  for (int i = 0; i < MAX_CHANNELS; i++)
+  {
+    Channel *expected = 0;
+    if (mChannels[i].load(std::memory_order_relaxed) == 0 &&
+        mChannels[i].compare_exchange_strong(expected, channel, std::memory_order_acq_rel))
+    {
+      int count = mNumChannels.load();
+      while (count <= i && !mNumChannels.compare_exchange_weak(count, i + 1))
+        ;
+      return i;
+    }
+  }
+  delete channel;
+  gLogger->error("Too many adapters share the port %d", mPort);
+  return -1;
+}
+
+void Server::closeChannel(int aChannel)
+{
+  Channel *channel = mChannels[aChannel].load(std::memory_order_acquire);
+  if (channel != 0)
+    channel->mOpen = false;
+}
+
+void Server::publish(Frame *aFrame, ClientId aClient, int aChannel)
+{
+  if (mIoThread == 0)
+  {
+    send(aFrame, aClient);
+    return;
+  }
+
+  Publication publication;
+  publication.mFrame = aFrame;
+  publication.mClient = aClient;
+  aFrame->retain();
+  Channel *channel = mChannels[aChannel].load(std::memory_order_relaxed);
+  if (!channel->mOutbox.push(publication))
+  {
+    /* The clients miss some data: the I/O thread disconnects them */
+    aFrame->release();
+    channel->mOverrun = true;
+  }
+  mIoThread->wakeUp();
+}
+
+size_t Server::pending(int aChannel)
+{
+  return mChannels[aChannel].load(std::memory_order_relaxed)->mOutbox.size();
+}
+
+size_t Server::maxQueued()
+{
+  size_t queued = 0;
+  for (int i = 0; i < mNumClients; i++)
+  {
+    if (mClients[i]->queued() > queued)
+      queued = mClients[i]->queued();
+  }
+  return queued;
+}
+
+bool Server::nextNewClient(ClientId &aClient, int aChannel)
+{
+  return mChannels[aChannel].load(std::memory_order_relaxed)->mNewClients.pop(aClient);
+}
+
+CycleStats *Server::getStats(int aChannel)
+{
+  return &mChannels[aChannel].load(std::memory_order_relaxed)->mStats;
+}
+
+void Server::writeStats(StringBuffer &aBuffer)
+{
+  char line[256];
+  int numChannels = channelCount();
+  for (int i = 0; i < numChannels; i++)
+  {
+    Channel *channel = mChannels[i].load(std::memory_order_acquire);
+    if (channel == 0 || !channel->mOpen)
+      continue;
+    for (int m = 0; m < CycleStats::eNUM_METRICS; m++)
+    {
+      aBuffer.append("* stats: ");
+      if (channel->mName[0] != '\0')
+        aBuffer.append(channel->mName).append(':');
+      int len = channel->mStats.format((CycleStats::EMetric) m, line, sizeof(line));
+      aBuffer.append(line, len);
+      aBuffer.newLine();
+    }
+  }
+}
+
+/* The # HELP and # TYPE lines of a metric */
+static void writeMetricHeader(StringBuffer &aBuffer, const char *aName, const char *aType,
+                              const char *aHelp)
+{
+  aBuffer.appendf("# HELP mtconnect_adapter_%s %s\n# TYPE mtconnect_adapter_%s %s\n",
+                  aName, aHelp, aName, aType);
+}
+
+/* A label value, with the characters Prometheus needs escaped */
+static void writeLabelValue(StringBuffer &aBuffer, const char *aValue)
+{
+  for (const char *c = aValue; *c != '\0'; c++)
+  {
+    if (*c == '\\' || *c == '"')
+      aBuffer.append('\\').append(*c);
+    else if (*c == '\n')
+      aBuffer.append("\\n");
+    else
+      aBuffer.append(*c);
+  }
+}
+
+void Server::writeMetrics(StringBuffer &aBuffer)
+{
+  static const char *clientMetrics[][3] = {
+    { "client_sent_bytes_total", "counter", "Bytes sent to the client" },
+    { "client_queued_bytes", "gauge", "Bytes waiting in the output queue of the client" },
+    { "client_partial_writes_total", "counter", "Sends to the client that did not take all the data" },
+    { "client_ping_interval_seconds", "gauge", "Time between the last two PINGs of the client" },
+    { "client_last_ping_age_seconds", "gauge", "Time since the last PING of the client" },
+    { "client_connected_seconds", "gauge", "Time since the client connected" },
+  };
+  static const char *disconnects[eNUM_DISCONNECTS] = {
+    "closed", "error", "queue_full", "heartbeat", "overrun"
+  };
+  static const CycleStats::EMetric timings[] = {
+    CycleStats::eCYCLE_TIME, CycleStats::eENCODE_TIME, CycleStats::eSEND_TIME
+  };
+  static const char *timingMetrics[][2] = {
+    { "cycle_seconds", "Duration of the cycles of the adapter, from start to the end of finish" },
+    { "encode_seconds", "Encoding of the changed values per cycle" },
+    { "send_seconds", "Publication of the encoded data per cycle" },
+  };
+  static const double quantiles[] = { 0.5, 0.9, 0.99 };
+  unsigned long long now = getMonotonicMilliseconds();
+
+  writeMetricHeader(aBuffer, "clients", "gauge", "Connected clients");
+  aBuffer.appendf("mtconnect_adapter_clients %d\n", mNumClients);
+  writeMetricHeader(aBuffer, "accepted_total", "counter", "Clients that were accepted");
+  aBuffer.appendf("mtconnect_adapter_accepted_total %llu\n", mAccepted);
+  writeMetricHeader(aBuffer, "rejected_total", "counter", "Clients that were not admitted");
+  aBuffer.appendf("mtconnect_adapter_rejected_total %llu\n", mRejected);
+  writeMetricHeader(aBuffer, "disconnects_total", "counter", "Clients that were disconnected, by reason");
+  for (int r = 0; r < eNUM_DISCONNECTS; r++)
+    aBuffer.appendf("mtconnect_adapter_disconnects_total{reason=\"%s\"} %llu\n",
+                    disconnects[r], mDisconnects[r]);
+
+  /* Clients */
+  for (int m = 0; m < (int) (sizeof(clientMetrics) / sizeof(clientMetrics[0])); m++)
+  {
+    writeMetricHeader(aBuffer, clientMetrics[m][0], clientMetrics[m][1], clientMetrics[m][2]);
+    for (int i = 0; i < mNumClients; i++)
     {
       Client *client = mClients[i];
-      if (FD_ISSET(client->socket(), &rset))
-      {
-        len = client->read(buffer, READ_BUFFER_LEN);
-        if (len > 0) 
-        {
-          // Check for heartbeat
-          if (strncmp(buffer, "* PING", 6) == 0)
-          {
-            if (!client->mHeartbeats)
-              client->mHeartbeats = true;
-            client->mLastHeartbeat = getTimestamp();
-            client->write(mPong);
-          }
-          else
-            printf("Received: %s", buffer);
-        }
-        else 
-          removeClient(client);
+      if (m >= 3 && m <= 4 && client->mLastPing == 0)
+        continue;   /* No PING yet */
+      struct in_addr peer;
+      peer.s_addr = client->mPeerAddress;
+      aBuffer.appendf("mtconnect_adapter_%s{client=\"%u\",peer=\"%s:%u\"} ",
+                      clientMetrics[m][0], client->mId, inet_ntoa(peer),
+                      (unsigned int) client->mPeerPort);
+      switch (m) {
+      case 0: aBuffer.appendf("%llu\n", client->mBytesSent); break;
+      case 1: aBuffer.appendf("%llu\n", (unsigned long long) client->queued()); break;
+      case 2: aBuffer.appendf("%llu\n", client->mPartialWrites); break;
+      case 3: aBuffer.appendf("%.3f\n", client->mPingInterval / 1000.0); break;
+      case 4: aBuffer.appendf("%.3f\n", (now - client->mLastPing) / 1000.0); break;
+      default: aBuffer.appendf("%.3f\n", (now - client->mConnectedAt) / 1000.0); break;
       }
     }
   }
 
-  // Check heartbeats
-  for (int i = mNumClients - 1; i >= 0; i--)
+  /* Publishers */
+  Channel *channels[MAX_CHANNELS];
+  int numChannels = 0;
+  for (int i = 0; i < channelCount(); i++)
   {
-    Client *client = mClients[i];
-    unsigned int now = getTimestamp();
-    if (client->mHeartbeats)
+    Channel *channel = mChannels[i].load(std::memory_order_acquire);
+    if (channel != 0 && channel->mOpen)
+      channels[numChannels++] = channel;
+  }
+
+  static const char *channelMetrics[][3] = {
+    { "data_values", "gauge", "Data values of the adapter" },
+    { "cycles_total", "counter", "Cycles of the adapter" },
+    { "changes_total", "counter", "Changed data values that were sent" },
+    { "held_changes_total", "counter", "Changes held back by a minimum interval or a window" },
+    { "suppressed_changes_total", "counter", "New values dropped by the deadband of a data value" },
+    { "sent_bytes_total", "counter", "Bytes published by the adapter, for all its clients" },
+  };
+  for (int m = 0; m < (int) (sizeof(channelMetrics) / sizeof(channelMetrics[0])); m++)
+  {
+    writeMetricHeader(aBuffer, channelMetrics[m][0], channelMetrics[m][1], channelMetrics[m][2]);
+    for (int i = 0; i < numChannels; i++)
     {
-      if (deltaTimestamp(now, client->mLastHeartbeat) > mTimeout)
-      {
-        gLogger->warning("Client has not sent heartbeat in over %d ms, disconnecting",
-          mTimeout);
-        removeClient(client);
+      CycleStats &stats = channels[i]->mStats;
+      aBuffer.appendf("mtconnect_adapter_%s{device=\"", channelMetrics[m][0]);
+      writeLabelValue(aBuffer, channels[i]->mName);
+      aBuffer.append("\"} ");
+      switch (m) {
+      case 0: aBuffer.appendf("%d\n", stats.mDataValues.load()); break;
+      case 1: aBuffer.appendf("%llu\n", stats.get(CycleStats::eCYCLE_TIME).count()); break;
+      case 2: aBuffer.appendf("%llu\n", stats.get(CycleStats::eCHANGES).sum()); break;
+      case 3: aBuffer.appendf("%llu\n", stats.mHeldChanges.load()); break;
+      case 4: aBuffer.appendf("%llu\n", stats.mSuppressedChanges.load()); break;
+      default: aBuffer.appendf("%llu\n", stats.get(CycleStats::eBYTES).sum()); break;
       }
     }
   }
+
+  for (int m = 0; m < 3; m++)
+  {
+    const char *name = timingMetrics[m][0];
+    writeMetricHeader(aBuffer, name, "summary", timingMetrics[m][1]);
+    for (int i = 0; i < numChannels; i++)
+    {
+      Histogram &histogram = channels[i]->mStats.get(timings[m]);
+      StringBuffer labels;
+      labels.append("device=\"");
+      writeLabelValue(labels, channels[i]->mName);
+      labels.append('"');
+      for (int q = 0; q < 3; q++)
+        aBuffer.appendf("mtconnect_adapter_%s{%s,quantile=\"%g\"} %.9f\n", name, labels.c_str(),
+                        quantiles[q], histogram.percentile(quantiles[q] * 100) / 1e9);
+      aBuffer.appendf("mtconnect_adapter_%s_sum{%s} %.9f\n", name, labels.c_str(),
+                      histogram.sum() / 1e9);
+      aBuffer.appendf("mtconnect_adapter_%s_count{%s} %llu\n", name, labels.c_str(),
+                      histogram.count());
+    }
+  }
+
+  /* Process */
+  unsigned long long frames = gProcessStats.mFrames, released = gProcessStats.mFramesReleased;
+  writeMetricHeader(aBuffer, "process_cycles_total", "counter", "Cycles of all the adapters");
+  aBuffer.appendf("mtconnect_adapter_process_cycles_total %llu\n", gProcessStats.mCycles.load());
+  writeMetricHeader(aBuffer, "process_frames_total", "counter", "Frames that were allocated");
+  aBuffer.appendf("mtconnect_adapter_process_frames_total %llu\n", frames);
+  writeMetricHeader(aBuffer, "process_frames", "gauge", "Frames that are not freed yet");
+  aBuffer.appendf("mtconnect_adapter_process_frames %llu\n",
+                  frames > released ? frames - released : 0ULL);
+  writeMetricHeader(aBuffer, "process_frame_bytes_total", "counter", "Bytes of the frames that were allocated");
+  aBuffer.appendf("mtconnect_adapter_process_frame_bytes_total %llu\n", gProcessStats.mFrameBytes.load());
+  writeMetricHeader(aBuffer, "process_buffer_growths_total", "counter", "Allocations of the string buffers");
+  aBuffer.appendf("mtconnect_adapter_process_buffer_growths_total %llu\n", gProcessStats.mBufferGrowths.load());
+  writeMetricHeader(aBuffer, "process_text_allocations_total", "counter", "Allocations of the long text values");
+  aBuffer.appendf("mtconnect_adapter_process_text_allocations_total %llu\n", gProcessStats.mTextAllocations.load());
 }
 
-void Server::sendToClient(Client *aClient, const char *aString)
+bool Server::StatsCommand::onCommand(Server &aServer, Client *aClient, const char *)
 {
-  if (aClient->write(aString) < 0)
-    removeClient(aClient);
+  StringBuffer buffer;
+  aServer.writeStats(buffer);
+  if (buffer.length() == 0)
+    return true;
+  return aServer.sendToClient(aClient, buffer.c_str());
 }
 
-void Server::sendToClients(const char *aString)
+/* Send or queue the frame. Returns false if the client had to be removed */
+bool Server::sendToClient(Client *aClient, Frame *aFrame)
+{
+  if (aClient->write(aFrame) < 0)
+  {
+    removeClient(aClient, aClient->mQueueFull ? eDISCONNECT_QUEUE_FULL : eDISCONNECT_ERROR);
+    return false;
+  }
+  updateWriteInterest(aClient);
+  return true;
+}
+
+void Server::sendToClients(Frame *aFrame)
 {
   for (int i = mNumClients - 1; i >= 0; i--)
-    sendToClient(mClients[i], aString);
+    sendToClient(mClients[i], aFrame);
 }
 
-Client **Server::connectToClients()
+bool Server::sendToClient(Client *aClient, const char *aString)
 {
-  fd_set rset;
-  FD_ZERO(&rset);
-  FD_SET(mSocket, &rset);
+  Frame *frame = Frame::create(aString, strlen(aString));
+  if (frame == 0)
+    return false;
+  bool res = sendToClient(aClient, frame);
+  frame->release();
+  return res;
+}
+
+void Server::sendToClients(const char *aString)
+{
+  Frame *frame = Frame::create(aString, strlen(aString));
+  if (frame == 0)
+    return;
+  sendToClients(frame);
+  frame->release();
+}
+
+/* Accept a pending connection, as a non-blocking socket */
+SOCKET Server::acceptClient(SOCKADDR_IN &aAddress)
+{
+  socklen_t len = sizeof(aAddress);
+  memset(&aAddress, 0, sizeof(aAddress));
+
+#if defined(__linux__) && defined(SOCK_NONBLOCK)
+  SOCKET socket = ::accept4(mSocket, (SOCKADDR*) &aAddress, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  SOCKET socket = ::accept(mSocket, (SOCKADDR*) &aAddress, &len);
+#endif
+  if (socket == INVALID_SOCKET) {
+    mAcceptable = false;
+    if (!SOCKET_WOULD_BLOCK)
+      gLogger->error("Error at accept().");
+    return socket;
+  }
+#if !(defined(__linux__) && defined(SOCK_NONBLOCK))
 #ifdef WIN32
-  int nfds = 1;
+  u_long nonBlocking = 1;
+  ioctlsocket(socket, FIONBIO, &nonBlocking);
 #else
-  int nfds = mSocket + 1;
+  fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+  fcntl(socket, F_SETFD, FD_CLOEXEC);
+#endif
 #endif
 
-  struct timeval timeout;
-  ::memset(&timeout, 0, sizeof(timeout));
+  return socket;
+}
 
-  Client **clients = mClients + mNumClients;
-  clients[0] = 0;
-  bool added = false;
+/* Returns why a client from this address cannot be admitted, 0 if it can */
+const char *Server::admit(const SOCKADDR_IN &aAddress)
+{
+  if (mNumClients >= MAX_CLIENTS)
+    return "too many clients";
+  if (mNumClients >= MAX_CLIENTS - mSettings.mReservedSlots)
+  {
+    for (size_t i = 0; i < mSettings.mPriorityPeers.size(); i++)
+    {
+      if (mSettings.mPriorityPeers[i] == (unsigned long) aAddress.sin_addr.s_addr)
+        return 0;
+    }
+    return "the remaining slots are reserved";
+  }
+  return 0;
+}
 
-  if (::select(nfds, &rset, 0, 0, &timeout) > 0)
+/* Send the reason of the rejection, as a comment line, and disconnect */
+void Server::reject(SOCKET aSocket, const SOCKADDR_IN &aAddress, const char *aReason)
+{
+  gLogger->warning("Rejected %s on port %d: %s", inet_ntoa(aAddress.sin_addr),
+                   ntohs(aAddress.sin_port), aReason);
+  mRejected++;
+
+  char line[128];
+  int len = snprintf(line, sizeof(line), "* REJECTED: %s\n", aReason);
+  ::send(aSocket, line, len, MSG_NOSIGNAL);   /* Best effort, the socket is non-blocking */
+  ::shutdown(aSocket, SHUT_RDWR);
+  ::closesocket(aSocket);
+}
+
+/* Tell the publishers about a new client. Returns false if one of them
+ * has too many new clients to initialize */
+bool Server::announce(ClientId aClient)
+{
+  bool res = true;
+  int numChannels = channelCount();
+  for (int i = 0; i < numChannels; i++)
+  {
+    Channel *channel = mChannels[i].load(std::memory_order_acquire);
+    if (channel != 0 && channel->mOpen && !channel->mNewClients.push(aClient))
+      res = false;
+  }
+  return res;
+}
+
+/* Accept the pending connections, until it would block */
+void Server::acceptClients()
+{
+  while (mAcceptable)
   {
     SOCKADDR_IN addr;
-    socklen_t len = sizeof(addr);
-    memset(&addr, 0, sizeof(addr));
+    SOCKET socket = acceptClient(addr);
+    if (socket == INVALID_SOCKET)
+      break;
 
-    SOCKET socket = ::accept(mSocket, (SOCKADDR*) &addr, &len);
-    if (socket == INVALID_SOCKET) {
-      gLogger->error("Error at accept().");
-      return 0;
+    const char *reason = admit(addr);
+    if (reason != 0) {
+      reject(socket, addr, reason);
+      continue;
+    }
+
+    /* The acquisition thread must learn about the client to initialize it */
+    ClientId id = mNextClientId++;
+    if (mNextClientId == 0)
+      mNextClientId = 1;
+    if (!announce(id)) {
+      reject(socket, addr, "too many new clients");
+      continue;
     }
     gLogger->info("Connected to: %s on port %d", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
 
-    Client *client = new Client(socket);
+    Client *client = new Client(socket, mMaxQueue);
+    client->mId = id;
+    client->mPeerAddress = addr.sin_addr.s_addr;
+    client->mPeerPort = ntohs(addr.sin_port);
+    client->mConnectedAt = getMonotonicMilliseconds();
+    mAccepted++;
+    /* With an I/O thread, the published data is only sent once the
+     * acquisition thread sent the initial data */
+    client->mInitialized = (mIoThread == 0);
     addClient(client);
-    added = true;
   }
-
-  if (added)
-    mClients[mNumClients] = 0;
-  else
-    clients = 0;
-
-  return clients;
 }
 
+Client *Server::findClient(ClientId aClient)
+{
+  for (int i = 0; i < mNumClients; i++)
+  {
+    if (mClients[i]->mId == aClient)
+      return mClients[i];
+  }
+  return 0;
+}
 
 /* Removes a client from the client list.
 * Because the client can be removed during list iteration, lists
 * should always be iterated from last to first. 
 */
-void Server::removeClient(Client *aClient)
+void Server::removeClient(Client *aClient, EDisconnect aReason)
 {
   int pos = 0;
 
@@ -253,7 +903,10 @@ void Server::removeClient(Client *aClient)
 
   if (pos < mNumClients)
   {
+    if (mPoller != 0)
+      mPoller->remove(aClient->socket());
     mNumClients--;
+    mClientCount = mNumClients;
     if (pos < mNumClients)
     {
       /* Shift the array left to remove the item */
@@ -261,50 +914,25 @@ void Server::removeClient(Client *aClient)
         mClients + (pos + 1),
         (mNumClients - pos) * sizeof(Client*));
     }
+    mDisconnects[aReason]++;
     delete aClient;
     mClients[mNumClients + 1] = 0;
   }
 }
 
-void Server::addClient(Client *aClient)
+bool Server::addClient(Client *aClient)
 {
-  if (mNumClients < MAX_CLIENTS)
+  if (mNumClients < MAX_CLIENTS && mPoller->add(aClient->socket(), aClient))
   {
     mClients[mNumClients] = aClient;
     mNumClients++;
+    mClientCount = mNumClients;
+    return true;
   }
   else
   {
     delete aClient;
+    return false;
   }
 }
 
-unsigned int Server::getTimestamp()
-{
-#ifdef WIN32
-  return (int)GetTickCount64();
-#else
-  timeval curtime;
-  gettimeofday(&curtime, 0);
-
-  unsigned long ts = (unsigned long) curtime.tv_sec;
-  // Allow to truncate
-  ts *= 1000;
-  ts += curtime.tv_usec / 1000;
-
-  return ts;
-#endif
-}
-
-unsigned int Server::deltaTimestamp(unsigned int a, unsigned int b)
-{
-  // Assume we are doing a - b where a should be larger, if it is not
-  // we have a wrap-around
-  unsigned int res;
-  if ( a >= b )
-    res = a - b;
-  else // b > a, Compute the distance from the end:
-  res = a + (0xFFFFFFFF - b);
-  return res;
-}
-
@@ -35,43 +35,215 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include "poller.hpp"
+#include "ring.hpp"
+#include "command_dispatcher.hpp"
+#include "timer_wheel.hpp"
+#include "histogram.hpp"
+
+#include <atomic>
+#include <vector>
+
 class Client;
+class Frame;
+class IoThread;
+class MetricsListener;
+class StringBuffer;
 
 /* Some constants */
 const int MAX_CLIENTS = 64;
+const int OUTBOX_SIZE = 1024;  /* Number of frames that can wait for the I/O thread */
+const int DEFAULT_BACKLOG = MAX_CLIENTS;  /* Pending connections, a full reconnect fits in */
+const int MAX_CHANNELS = 256;  /* Publishers of a shared server */
+const int CHANNEL_NAME_LEN = 32;
+
+/* Identifier of a client, 0 stands for all the clients */
+typedef unsigned int ClientId;
+
+/*
+ * Admission of the clients, fixed once the server listens.
+ *
+ * The last mReservedSlots slots are only given to the priority peers. A
+ * client that is not admitted is sent the reason and disconnected.
+ */
+struct ServerSettings
+{
+  int mBacklog;
+  int mReservedSlots;
+  std::vector<unsigned long> mPriorityPeers;  /* IPv4 addresses, network order */
+  bool mShared;   /* Several publishers, that open their channel */
+  int mMetricsPort;  /* Port of the Prometheus metrics, -1: none */
+
+  ServerSettings() : mBacklog(DEFAULT_BACKLOG), mReservedSlots(0), mShared(false),
+                     mMetricsPort(-1) { }
+};
 
-/* A socket server abstraction */
-class Server
+/*
+ * A socket server abstraction.
+ *
+ * The I/O (accept, read, heartbeats, send) is made by process(). The data is
+ * sent with publish(), and the new clients are returned by nextNewClient().
+ *
+ * Without I/O thread, everything is called by the same thread and publish()
+ * sends directly. With an I/O thread, process() is called by the I/O thread,
+ * while publish() and nextNewClient() are called by a single acquisition
+ * thread, and only exchange some data with it through lock-free rings: the
+ * acquisition thread is never slowed down by the network.
+ *
+ * Each acquisition thread publishes through its own channel. A server has a
+ * single channel (0), unless it is shared by several adapters: each of them
+ * then opens a channel, and is told about all the new clients.
+ *
+ * The lines "* <command> <arguments>" sent by the clients are dispatched to
+ * the command handlers. The server handles PING, and "stats", that replies
+ * with the statistics of the cycles of the publishers. The other lines are
+ * ignored.
+ *
+ * With a metrics port, the counters of the clients and of the publishers
+ * are also served over HTTP, in the Prometheus text format.
+ */
+class Server : public PollHandler, public CommandHandler
 {
+public:
+  /* Why a client was disconnected */
+  enum EDisconnect {
+    eDISCONNECT_CLOSED,      /* By the client */
+    eDISCONNECT_ERROR,       /* Socket error */
+    eDISCONNECT_QUEUE_FULL,  /* Too slow, its output queue is full */
+    eDISCONNECT_HEARTBEAT,   /* No PING in time */
+    eDISCONNECT_OVERRUN,     /* The I/O thread did not keep up */
+    eNUM_DISCONNECTS
+  };
+
 protected:
+  struct Publication {
+    Frame *mFrame;
+    ClientId mClient;
+  };
+
+  /* What a publisher exchanges with the I/O thread */
+  struct Channel {
+    SpscRing<Publication> mOutbox;   /* Acquisition thread -> I/O thread */
+    SpscRing<ClientId> mNewClients;  /* I/O thread -> acquisition thread */
+    std::atomic<bool> mOverrun;      /* Some frames could not be published */
+    std::atomic<bool> mOpen;         /* The publisher did not close it */
+    CycleStats mStats;               /* Recorded by the publisher */
+    char mName[CHANNEL_NAME_LEN];    /* The device of the publisher, if shared */
+
+    Channel(const char *aName);
+  };
+
+  /* "* stats" */
+  struct StatsCommand : public CommandHandler {
+    virtual bool onCommand(Server &aServer, Client *aClient, const char *aArguments);
+  };
+
   SOCKET mSocket;
+  Poller *mPoller;        /* The poller the sockets are registered in, 0 if not attached */
+  Poller *mOwnedPoller;   /* Without I/O thread: the poller of the server */
+  IoThread *mIoThread;
+  bool mAcceptable;
   Client *mClients[MAX_CLIENTS + 1];
   int mNumClients;
+  std::atomic<int> mClientCount;   /* mNumClients, for the acquisition thread */
+  ClientId mNextClientId;
   int mPort;
-  char mPong[32];
-  unsigned int mTimeout;
+  ServerSettings mSettings;
+  Frame *mPong;     /* The PONG reply, shared by all the clients */
+  unsigned int mTimeout;   /* The client is disconnected if it does not PING for that long (ms) */
+  TimerWheel mTimers;      /* The heartbeats of the clients */
+  std::atomic<size_t> mMaxQueue;  /* Bound of the output queue of each client */
+
+  std::atomic<Channel *> mChannels[MAX_CHANNELS];
+  std::atomic<int> mNumChannels;
+
+  CommandDispatcher mCommands;
+  MetricsListener *mMetrics;   /* 0 without metrics port */
+
+  /* Counters, for the metrics (I/O side) */
+  unsigned long long mAccepted;
+  unsigned long long mRejected;
+  unsigned long long mDisconnects[eNUM_DISCONNECTS];
+  StatsCommand mStatsCommand;
   
 protected:
-  void removeClient(Client *aClient);
-  void addClient(Client *aClient);
-  unsigned int getTimestamp();
-  unsigned int deltaTimestamp(unsigned int, unsigned int);
+  void init(int aPort, int aHeartbeatFreq, const ServerSettings &aSettings);
+  void removeClient(Client *aClient, EDisconnect aReason);
+  bool addClient(Client *aClient);
+  Client *findClient(ClientId aClient);
+  SOCKET acceptClient(SOCKADDR_IN &aAddress);
+  void acceptClients();
+  bool announce(ClientId aClient);
+  /* The slots that may hold a channel: the highest slot ever used, plus one */
+  int channelCount() { return mNumChannels.load(std::memory_order_acquire); }
+  const char *admit(const SOCKADDR_IN &aAddress);
+  void reject(SOCKET aSocket, const SOCKADDR_IN &aAddress, const char *aReason);
+  void readFromClients();
+  bool dispatch(Client *aClient);
+  void checkHeartbeats();
+  void flushClients();
+  void drainOutbox();
+  void send(Frame *aFrame, ClientId aClient);
+  void updateWriteInterest(Client *aClient);
   
 public:
-  Server(int aPort, int aHeartbeatFreq);
+  /* Server with its own poller, that is processed by the caller */
+  Server(int aPort, int aHeartbeatFreq, Poller::EMode aPollMode = Poller::eSELECT,
+         const ServerSettings &aSettings = ServerSettings());
+  /* Server that is processed by an I/O thread */
+  Server(int aPort, int aHeartbeatFreq, IoThread *aIoThread,
+         const ServerSettings &aSettings = ServerSettings());
   ~Server();
 
-  // Returns the list of new clients.
-  Client **connectToClients(); /* Client factory */
+  /* I/O side */
+  void process();                      /* Poll the sockets once (without I/O
+                                          thread), accept the new clients,
+                                          read from the clients, send */
+  void attach(Poller *aPoller);        /* Register the sockets */
+  void detach();                       /* Unregister the sockets */
+  virtual void onPoll(const Poller::Event &aEvent);
+  /* PING */
+  virtual bool onCommand(Server &aServer, Client *aClient, const char *aArguments);
+  /* Handle a "* <command>" line. Returns false if there are too many commands */
+  bool addCommand(const char *aName, CommandHandler *aHandler) { return mCommands.add(aName, aHandler); }
 
-  /* I/O methods */
-  void readFromClients();         /* discard data on read side of
-                                        sockets */
+  void sendToClients(Frame *aFrame);
+  bool sendToClient(Client *aClient, Frame *aFrame);
   void sendToClients(const char *aString);
-  void sendToClient(Client *aClient, const char *aString);
+  bool sendToClient(Client *aClient, const char *aString);
+
+  /* Acquisition side */
+  /* Open the channel of a new publisher of a shared server, for a device.
+   * Returns -1 if there are too many */
+  int openChannel(const char *aName = "");
+  /* The publisher is gone: it is not told about the new clients anymore, and
+   * the channel is freed by the I/O side once what it published is sent.
+   * The channel and its statistics must not be used after this call */
+  void closeChannel(int aChannel);
+  /* Send the frame to a client, or to all of them. The frame is retained */
+  void publish(Frame *aFrame, ClientId aClient = 0, int aChannel = 0);
+  /* Get a client that was connected since the previous call.
+   * It does not get the published data until it is sent some data specifically. */
+  bool nextNewClient(ClientId &aClient, int aChannel = 0);
+  /* Number of frames the I/O thread did not take yet, 0 without I/O thread */
+  size_t pending(int aChannel = 0);
+  /* Where the publisher records the statistics of its cycles */
+  CycleStats *getStats(int aChannel = 0);
+  /* The statistics of all the open channels, a "* stats:" line per metric */
+  void writeStats(StringBuffer &aBuffer);
+  /* I/O side: the counters of the clients, channels and process, in the
+   * Prometheus text format */
+  void writeMetrics(StringBuffer &aBuffer);
   
-  /* Getters */
-  int numClients() { return mNumClients; }
+  /* Getters / Setters */
+  int numClients() { return mClientCount.load(); }
+  size_t maxQueued();   /* I/O side: the largest output queue of the clients (bytes) */
+  int getPort() { return mPort; }
+  int getMetricsPort();   /* 0 if the metrics are not served */
+  bool isThreaded() { return mIoThread != 0; }
+  Poller::EMode getPollMode();
+  size_t getMaxQueue() { return mMaxQueue; }
+  void setMaxQueue(size_t aMaxQueue) { mMaxQueue = aMaxQueue; } /* For the next clients */
   
 };
 
@@ -34,83 +34,113 @@
 
 #include "internal.hpp"
 #include "string_buffer.hpp"
+#include "logger.hpp"
+#include "histogram.hpp"
+
+#include <charconv>
+#include <stdarg.h>
 
 StringBuffer::StringBuffer(const char *aString)
 {
-  mLength = mSize = 0;
-  mTimestamp[0] = 0;
+  mBuffer = 0;
+  mLength = mSize = mLineStart = mLines = 0;
+  mTimestampLength = 0;
+  grow(STRING_BUFFER_INITIAL_SIZE);
   if (aString != 0)
-  {
     append(aString);
-  }
-  else
-  {
-    mBuffer = 0;
-  }
 }
 
 StringBuffer::~StringBuffer()
 {
-  if (mBuffer != 0)
-    free(mBuffer);
+  free(mBuffer);
 }
 
-const char *StringBuffer::append(const char* aString)
+/* Make sure the buffer can hold aSize characters, terminating nul included */
+void StringBuffer::grow(size_t aSize)
 {
-  /* Include additional length for timestamp */
-  size_t len = strlen(aString);
-  size_t totalLength = mLength + len;
-  size_t tsLen = strlen(mTimestamp);
-  if (mLength == 0)
-    totalLength += tsLen;
-  if (totalLength >= mSize)
-  {
-    size_t newLen = ((totalLength / 1024) + 1) * 1024;
-    char *newBuffer = (char*) malloc(newLen);
-    memcpy(newBuffer, mBuffer, mLength);
-    
-    free(mBuffer);
-    mBuffer = newBuffer;
-    mSize = newLen;
-  }
-  
-  if (mLength == 0 && tsLen > 0)
+  if (aSize <= mSize)
+    return;
+
+  size_t newSize = mSize < STRING_BUFFER_INITIAL_SIZE ? STRING_BUFFER_INITIAL_SIZE : mSize;
+  while (newSize < aSize)
+    newSize *= 2;
+  char *newBuffer = (char *) realloc(mBuffer, newSize);
+  gProcessStats.mBufferGrowths.fetch_add(1, std::memory_order_relaxed);
+  if (newBuffer == 0)
   {
-    strcpy(mBuffer, mTimestamp);
-    mLength += tsLen;
+    /* Nothing sensible can be done without memory */
+    if (gLogger != NULL)
+      gLogger->error("Failed to allocate %d bytes for a string buffer", (int) newSize);
+    exit(1);
   }
-
-  strcpy(mBuffer + mLength, aString);
-  mLength += len;
-  
-  return mBuffer;
+  if (mBuffer == 0)
+    newBuffer[0] = '\0';
+  mBuffer = newBuffer;
+  mSize = newSize;
 }
 
-void StringBuffer::reset()
+StringBuffer &StringBuffer::appendf(const char *aFormat, ...)
 {
-  if (mBuffer != 0)
+  prepareLine(0);
+  for (;;)
   {
-    mBuffer[0] = 0;
-    mLength = 0;
+    size_t available = mSize - mLength;
+    va_list args;
+    va_start(args, aFormat);
+    int len = vsnprintf(mBuffer + mLength, available, aFormat, args);
+    va_end(args);
+    if (len < 0)
+    {
+      mBuffer[mLength] = '\0';
+      break;
+    }
+    if ((size_t) len < available)
+    {
+      mLength += len;
+      break;
+    }
+    grow(mLength + len + 1);
   }
+  return *this;
 }
 
-void StringBuffer::timestamp()
+StringBuffer &StringBuffer::appendNumber(long long aValue)
 {
-#ifdef WIN32
-  SYSTEMTIME st;
-  GetSystemTime(&st);
-  sprintf(mTimestamp, "%4d-%02d-%02dT%02d:%02d:%02d.%04dZ", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
-#else
-  struct timeval tv;
-  struct timezone tz;
-  
-  gettimeofday(&tv, &tz);
-  
-  strftime(mTimestamp, 64, "%Y-%m-%dT%H:%M:%S", gmtime(&tv.tv_sec));
-  sprintf(mTimestamp + strlen(mTimestamp), ".%06dZ", tv.tv_usec);
-#endif
+  char *first = prepare(24);
+  commit(std::to_chars(first, first + 24, aValue).ptr);
+  return *this;
 }
 
+StringBuffer &StringBuffer::appendNumber(double aValue, const FloatFormat &aFormat)
+{
+  /* The shortest fixed notation of a large value can be long: try with
+   * some room first, the format falls back to an exponent if needed */
+  char *first = prepare(FLOAT_FALLBACK_LEN * 2);
+  commit(aFormat.format(first, first + FLOAT_FALLBACK_LEN * 2, aValue));
+  return *this;
+}
 
+/* End the current line: the next append starts a new line with its own timestamp */
+void StringBuffer::newLine()
+{
+  grow(mLength + 2);
+  mBuffer[mLength++] = '\n';
+  mBuffer[mLength] = 0;
+  mLineStart = mLength;
+  mLines++;
+}
 
+void StringBuffer::reset()
+{
+  mBuffer[0] = 0;
+  mLength = 0;
+  mLineStart = 0;
+  mLines = 0;
+}
+
+/* Take the current time as the timestamp of the next lines */
+void StringBuffer::timestamp()
+{
+  mClock.now();
+  mTimestampLength = mClock.length();
+}
@@ -35,31 +35,91 @@
 #ifndef STRING_BUFFER_HPP
 #define STRING_BUFFER_HPP
 
+#include <stddef.h>
+#include <string.h>
+
+#include "timestamp.hpp"
+#include "float_format.hpp"
+
+/* Some constants */
+const size_t STRING_BUFFER_INITIAL_SIZE = 1024;
+
 /*
  * A simple extensible string that can be appended to. The memory will be reused
  * since it maintains its length. The string buffer also supports setting a timestamp
- * that will be prepended to the string once some data is appended.
+ * that will be prepended to each line once some data is appended to it.
  *
- * Currently allocating in 1k increments.
+ * The allocation at least doubles each time it grows, and is kept by
+ * reset(): once the buffer reached the size of the largest cycle, it is
+ * not reallocated anymore. The string is always nul-terminated.
  */
-public class StringBuffer 
+class StringBuffer 
 {
 protected:
   char *mBuffer; /* A resizable character buffer */
   size_t mSize;     /* The allocated size of the string */
   size_t mLength;   /* The length of the string */
-  char mTimestamp[64];
+  size_t mLineStart; /* The position where the current line starts */
+  size_t mLines;     /* Number of the ended lines */
+  TimestampFormatter mClock;  /* Renders the timestamp of the lines */
+  size_t mTimestampLength;   /* 0 until the first call to timestamp() */
+
+protected:
+  void grow(size_t aSize);
+  /* Make sure aLength more characters can be written, after the timestamp
+   * if a line is started */
+  void prepareLine(size_t aLength)
+  {
+    size_t needed = mLength + aLength + 1;
+    if (mLength == mLineStart)
+      needed += mTimestampLength;
+    if (needed > mSize)
+      grow(needed);
+    if (mLength == mLineStart && mTimestampLength > 0)
+    {
+      memcpy(mBuffer + mLength, mClock.text(), mTimestampLength);
+      mLength += mTimestampLength;
+    }
+  }
   
 public:
   StringBuffer(const char *aString = 0);
   ~StringBuffer();
 
   operator const char *() { return mBuffer; }
-  const char *append(const char *aString);
-  const char* operator<<(const char *aString) { return append(aString); }
+  const char *c_str() { return mBuffer; }
+
+  StringBuffer &append(const char *aData, size_t aLength)
+  {
+    prepareLine(aLength);
+    memcpy(mBuffer + mLength, aData, aLength);
+    mLength += aLength;
+    mBuffer[mLength] = '\0';
+    return *this;
+  }
+  StringBuffer &append(const char *aString) { return append(aString, strlen(aString)); }
+  StringBuffer &append(char aChar) { return append(&aChar, 1); }
+  StringBuffer &operator<<(const char *aString) { return append(aString); }
+
+  /* Format in place, printf style */
+  StringBuffer &appendf(const char *aFormat, ...);
+  StringBuffer &appendNumber(long long aValue);
+  StringBuffer &appendNumber(double aValue, const FloatFormat &aFormat = FloatFormat());
+
+  /* Direct writing: get room for at most aMaxLength characters at the end of
+   * the buffer (after the timestamp if a line is started), write them, then
+   * call commit() with the end of what was written */
+  char *prepare(size_t aMaxLength) { prepareLine(aMaxLength); return mBuffer + mLength; }
+  void commit(char *aEnd) { mLength = aEnd - mBuffer; mBuffer[mLength] = '\0'; }
+
+  void reserve(size_t aCapacity) { if (aCapacity + 1 > mSize) grow(aCapacity + 1); }
+  void newLine();
   void reset();
   void timestamp();
   size_t  length() { return mLength; }
+  size_t  lineLength() { return mLength - mLineStart; }
+  size_t  lines() { return mLines; }
+  size_t  capacity() { return mSize - 1; }
 };
 
 #endif
@@ -0,0 +1,134 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+/*
+ * Admission of the clients: the clients that cannot be admitted are sent
+ * the reason and disconnected.
+ */
+
+#include "test.hpp"
+#include "server.hpp"
+
+#include <memory>
+#include <vector>
+
+/* Process the server until it counts aCount clients, or for a while */
+static void process(Server &aServer, int aCount = -1)
+{
+  for (int i = 0; i < 100 && aServer.numClients() != aCount; i++) {
+    aServer.process();
+    sleepMs(2);
+  }
+}
+
+/* Process the server until the client is disconnected */
+static bool rejected(Server &aServer, TestClient &aClient, const char *aLine)
+{
+  for (int i = 0; i < 200; i++) {
+    aServer.process();
+    if (aClient.closedByServer(5))
+      return aClient.received() == aLine;
+  }
+  return false;
+}
+
+/* All the slots are reserved, and the loopback is not a priority peer */
+static void testReservedSlots()
+{
+  ServerSettings settings;
+  settings.mReservedSlots = MAX_CLIENTS;
+  Server server(0, 10000, Poller::eSELECT, settings);
+
+  TestClient client(server.getPort());
+  CHECK(rejected(server, client, "* REJECTED: the remaining slots are reserved\n"));
+  CHECK_EQUAL(0, server.numClients());
+}
+
+/* The priority peers get the reserved slots */
+static void testPriorityPeer()
+{
+  ServerSettings settings;
+  settings.mReservedSlots = 1;
+  settings.mPriorityPeers.push_back(htonl(INADDR_LOOPBACK));
+  Server server(0, 10000, Poller::eSELECT, settings);
+
+  std::vector<std::unique_ptr<TestClient> > clients;
+  for (int i = 0; i < MAX_CLIENTS; i++) {
+    clients.push_back(std::unique_ptr<TestClient>(new TestClient(server.getPort())));
+    process(server, i + 1);
+  }
+  CHECK_EQUAL(MAX_CLIENTS, server.numClients());
+  for (int i = 0; i < MAX_CLIENTS; i++)
+    CHECK(clients[i]->received().find("REJECTED") == std::string::npos);
+
+  /* No slot left, even for a priority peer */
+  TestClient extra(server.getPort());
+  CHECK(rejected(server, extra, "* REJECTED: too many clients\n"));
+  CHECK_EQUAL(MAX_CLIENTS, server.numClients());
+}
+
+/* Without priority peer, the reserved slots stay free */
+static void testReservedKeptFree()
+{
+  ServerSettings settings;
+  settings.mReservedSlots = MAX_CLIENTS - 2;
+  Server server(0, 10000, Poller::eSELECT, settings);
+
+  TestClient first(server.getPort());
+  process(server, 1);
+  TestClient second(server.getPort());
+  process(server, 2);
+  CHECK_EQUAL(2, server.numClients());
+
+  TestClient third(server.getPort());
+  CHECK(rejected(server, third, "* REJECTED: the remaining slots are reserved\n"));
+  CHECK_EQUAL(2, server.numClients());
+
+  /* A slot is given again once a client left */
+  first.close();
+  process(server, 1);
+  TestClient fourth(server.getPort());
+  process(server, 2);
+  CHECK_EQUAL(2, server.numClients());
+  CHECK(fourth.received().empty());
+}
+
+int main()
+{
+  initTest();
+  testReservedSlots();
+  testPriorityPeer();
+  testReservedKeptFree();
+  return testResult("admission_test");
+}
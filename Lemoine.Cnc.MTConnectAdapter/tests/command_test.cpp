@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+/*
+ * The lines sent by the clients: whatever the way they are split in the
+ * packets, they are dispatched to the command handlers once complete.
+ */
+
+#include "test.hpp"
+#include "server.hpp"
+#include "client.hpp"
+
+#include <string>
+
+/* Replies "* ECHO [<arguments>]" */
+class EchoCommand : public CommandHandler
+{
+public:
+  virtual bool onCommand(Server &aServer, Client *aClient, const char *aArguments)
+  {
+    std::string reply = std::string("* ECHO [") + aArguments + "]\n";
+    return aServer.sendToClient(aClient, reply.c_str());
+  }
+};
+
+/* Process the server until the client received aText */
+static bool pump(Server &aServer, TestClient &aClient, const char *aText)
+{
+  for (int i = 0; i < 400; i++) {
+    aServer.process();
+    if (aClient.received().find(aText) != std::string::npos)
+      return true;
+    sleepMs(5);
+  }
+  return false;
+}
+
+static void waitForClients(Server &aServer, int aCount)
+{
+  for (int i = 0; i < 400 && aServer.numClients() < aCount; i++) {
+    aServer.process();
+    sleepMs(5);
+  }
+  CHECK_EQUAL(aCount, aServer.numClients());
+}
+
+static int count(const std::string &aText, const char *aPattern)
+{
+  int n = 0;
+  for (size_t pos = aText.find(aPattern); pos != std::string::npos;
+       pos = aText.find(aPattern, pos + 1))
+    n++;
+  return n;
+}
+
+static void testLines(Poller::EMode aMode)
+{
+  Server server(0, 1000, aMode);
+  EchoCommand echo;
+  CHECK(server.addCommand("ECHO", &echo));
+  TestClient client(server.getPort());
+  waitForClients(server, 1);
+
+  /* Split in two packets */
+  client.send("* PI");
+  for (int i = 0; i < 5; i++) {
+    server.process();
+    sleepMs(2);
+  }
+  CHECK(client.received().empty());
+  client.send("NG\n");
+  CHECK(pump(server, client, "* PONG 1000\n"));
+
+  /* Pipelined in a single packet, with CRLF */
+  client.send("* PING\r\n* ECHO one two\r\n* PING\n");
+  CHECK(pump(server, client, "* ECHO [one two]\n"));
+  CHECK(pump(server, client, "* PONG 1000\n* ECHO [one two]\n* PONG 1000\n"));
+  CHECK_EQUAL(3, count(client.received(), "* PONG 1000\n"));
+
+  /* A line that is too long is dropped, not the next one */
+  std::string longLine = "* ECHO " + std::string(3 * CLIENT_INPUT_SIZE, 'x') + "\n";
+  client.send(longLine.c_str());
+  client.send("* ECHO after\n");
+  CHECK(pump(server, client, "* ECHO [after]\n"));
+  CHECK(client.received().find("xxx") == std::string::npos);
+
+  /* Unknown commands and other lines are ignored */
+  client.send("* UNKNOWN\nPING\n* PING\n");
+  CHECK(pump(server, client, "* ECHO [after]\n* PONG 1000\n"));
+  CHECK_EQUAL(4, count(client.received(), "* PONG"));
+  CHECK_EQUAL(1, server.numClients());
+}
+
+int main()
+{
+  initTest();
+  testLines(Poller::eSELECT);
+  testLines(Poller::eEPOLL);
+  return testResult("command_test");
+}
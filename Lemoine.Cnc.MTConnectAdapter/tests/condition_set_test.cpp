@@ -0,0 +1,160 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+/*
+ * ConditionSet: only the activations, the changes and the clears of the
+ * submitted alarms are sent.
+ */
+
+#include "test.hpp"
+#include "device_datum.hpp"
+#include "string_buffer.hpp"
+
+#include <algorithm>
+#include <string>
+
+/* What the alarms write for the cycle, "" if they did not change */
+static std::string cycle(ConditionSet &aAlarms)
+{
+  if (!aAlarms.changed())
+    return "";
+  StringBuffer buffer;
+  aAlarms.append(buffer);
+  buffer.newLine();
+  return buffer.c_str();
+}
+
+static void testChanges()
+{
+  ConditionSet alarms("alarms");
+
+  alarms.begin();
+  alarms.add(Condition::eFAULT, "Overheat", "A1");
+  alarms.add(Condition::eWARNING, "Low oil", "A2", "LOW", "2");
+  alarms.end();
+  CHECK(cycle(alarms) == "|alarms|FAULT|A1|||Overheat\n|alarms|WARNING|A2|2|LOW|Low oil\n");
+
+  /* Same alarms: nothing is sent */
+  alarms.begin();
+  CHECK(!alarms.add(Condition::eWARNING, "Low oil", "A2", "LOW", "2"));
+  CHECK(!alarms.add(Condition::eFAULT, "Overheat", "A1"));
+  alarms.end();
+  CHECK(cycle(alarms) == "");
+
+  /* A1 changes, A2 is cleared */
+  alarms.begin();
+  CHECK(alarms.add(Condition::eFAULT, "Overheat\nspindle", "A1"));
+  alarms.end();
+  CHECK_EQUAL(1, alarms.activeCount());
+  CHECK(cycle(alarms) == "|alarms|FAULT|A1|||Overheat spindle\n|alarms|NORMAL|A2|||\n");
+
+  /* A cleared code that is raised again is new */
+  alarms.begin();
+  alarms.add(Condition::eFAULT, "Overheat\nspindle", "A1");
+  CHECK(alarms.add(Condition::eWARNING, "Low oil", "A2"));
+  alarms.end();
+  CHECK(cycle(alarms) == "|alarms|WARNING|A2|||Low oil\n");
+
+  /* Nothing active anymore: a single NORMAL */
+  alarms.begin();
+  alarms.end();
+  CHECK_EQUAL(0, alarms.activeCount());
+  CHECK(cycle(alarms) == "|alarms|NORMAL||||\n");
+}
+
+/* A new client gets all the active alarms */
+static void testSnapshot()
+{
+  ConditionSet alarms("alarms");
+  StringBuffer buffer;
+  alarms.writeSnapshotTo(buffer);
+  CHECK(std::string(buffer.c_str()) == "|alarms|UNAVAILABLE||||");
+
+  alarms.begin();
+  alarms.add(Condition::eFAULT, "Overheat", "A1");
+  alarms.add(Condition::eWARNING, "Low oil", "A2");
+  alarms.end();
+  cycle(alarms);
+  alarms.begin();
+  alarms.add(Condition::eWARNING, "Low oil", "A2");
+  alarms.add(Condition::eWARNING, "Door", "A3");
+  alarms.end();
+  cycle(alarms);
+
+  buffer.reset();
+  alarms.writeSnapshotTo(buffer);
+  std::string snapshot = buffer.c_str();
+  CHECK(snapshot.find("|alarms|WARNING|A2|||Low oil") != std::string::npos);
+  CHECK(snapshot.find("|alarms|WARNING|A3|||Door") != std::string::npos);
+  CHECK(snapshot.find("A1") == std::string::npos);
+}
+
+/* Many alarms: only the one that is cleared is sent */
+static void testManyAlarms()
+{
+  const int count = 2000;
+  ConditionSet alarms("alarms");
+  char code[32];
+
+  for (int pass = 0; pass < 2; pass++) {
+    alarms.begin();
+    for (int i = 0; i < count; i++) {
+      snprintf(code, sizeof(code), "E%d", i);
+      alarms.add(Condition::eFAULT, "Fault", code);
+    }
+    alarms.end();
+    std::string lines = cycle(alarms);
+    CHECK_EQUAL(pass == 0 ? count : 0, (long long) std::count(lines.begin(), lines.end(), '\n'));
+  }
+
+  alarms.begin();
+  for (int i = 0; i < count; i++) {
+    if (i == 1234)
+      continue;
+    snprintf(code, sizeof(code), "E%d", i);
+    alarms.add(Condition::eFAULT, "Fault", code);
+  }
+  alarms.end();
+  CHECK_EQUAL(count - 1, alarms.activeCount());
+  CHECK(cycle(alarms) == "|alarms|NORMAL|E1234|||\n");
+}
+
+int main()
+{
+  initTest();
+  testChanges();
+  testSnapshot();
+  testManyAlarms();
+  return testResult("condition_set_test");
+}
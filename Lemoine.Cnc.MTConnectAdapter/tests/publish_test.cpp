@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+/*
+ * Publication of the data to the clients, with and without I/O thread:
+ * initial data of the new clients, then the changes.
+ */
+
+#include "test.hpp"
+#include "adapter_core.hpp"
+#include "device_datum.hpp"
+#include "server.hpp"
+
+/* Run cycles until the server counts aCount clients */
+static bool waitForClients(AdapterCore &aCore, int aCount)
+{
+  for (int i = 0; i < 200; i++) {
+    aCore.start();
+    aCore.finish();
+    if (aCore.server()->numClients() == aCount)
+      return true;
+    sleepMs(5);
+  }
+  return false;
+}
+
+/* A client that connects before any value is set gets the next changes */
+static void testClientBeforeFirstValue(bool aIoThread)
+{
+  AdapterCore core(0);
+  core.setIoThread(aIoThread);
+  Sample position("Xact");
+  core.addDatum(position);
+  core.start();
+  core.finish();
+
+  TestClient client(core.getPort());
+  CHECK(waitForClients(core, 1));
+  /* The cycle the client is initialized in */
+  core.start();
+  core.finish();
+
+  for (int i = 1; i <= 5; i++) {
+    core.start();
+    position.setValue(i);
+    core.finish();
+    sleepMs(5);
+  }
+  CHECK(client.waitFor("|Xact|5"));
+  CHECK_EQUAL(5, client.countLines("|Xact|"));
+}
+
+/* A client that connects once some values are set gets them first, then the changes */
+static void testInitialData(bool aIoThread)
+{
+  AdapterCore core(0);
+  core.setIoThread(aIoThread);
+  Sample position("Xact");
+  Event program("program");
+  core.addDatum(position);
+  core.addDatum(program);
+  core.start();
+  position.setValue(1);
+  program.setValue("O1000");
+  core.finish();
+
+  TestClient client(core.getPort());
+  CHECK(waitForClients(core, 1));
+  CHECK(client.waitFor("|program|O1000"));
+  CHECK_EQUAL(1, client.countLines("|Xact|1"));
+
+  core.start();
+  position.setValue(2);
+  core.finish();
+  CHECK(client.waitFor("|Xact|2"));
+  /* The unchanged value is not sent again */
+  CHECK_EQUAL(1, client.countLines("|program|"));
+}
+
+int main()
+{
+  initTest();
+  testClientBeforeFirstValue(false);
+  testClientBeforeFirstValue(true);
+  testInitialData(false);
+  testInitialData(true);
+  return testResult("publish_test");
+}
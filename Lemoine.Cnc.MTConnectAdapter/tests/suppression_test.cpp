@@ -0,0 +1,235 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+
+/*
+ * Suppression of the changes: absolute and relative deadbands of the samples,
+ * deadbands of the path positions, minimum interval and maximum silence.
+ */
+
+#include "test.hpp"
+#include "adapter_core.hpp"
+#include "device_datum.hpp"
+#include "server.hpp"
+#include "string_buffer.hpp"
+
+/* Send the value as a cycle would: the next values are compared to it */
+static void sent(DeviceDatum &aValue)
+{
+  StringBuffer buffer;
+  aValue.append(buffer);
+}
+
+static void testDeadband()
+{
+  Sample position("Xact");
+  position.setDeadband(1.0);
+  CHECK(position.setValue(10.0));
+  sent(position);
+
+  CHECK(!position.setValue(10.5));
+  CHECK(!position.setValue(11.0));
+  CHECK(!position.setValue(9.2));
+  /* The band is around the last sent value, the suppressed ones do not move it */
+  CHECK(position.getValue() == 10.0);
+  CHECK(position.setValue(11.5));
+  CHECK(position.getValue() == 11.5);
+  sent(position);
+
+  /* A value after unavailable is always sent */
+  position.unavailable();
+  sent(position);
+  CHECK(position.setValue(11.5));
+}
+
+static void testRelativeDeadband()
+{
+  Sample load("load");
+  load.setRelativeDeadband(10.0);
+  CHECK(load.setValue(100.0));
+  sent(load);
+  CHECK(!load.setValue(105.0));
+  CHECK(!load.setValue(91.0));
+  CHECK(load.setValue(111.0));
+  sent(load);
+
+  /* The absolute deadband applies when it is larger */
+  load.setDeadband(20.0);
+  CHECK(!load.setValue(130.0));
+  CHECK(load.setValue(132.0));
+  sent(load);
+
+  /* Near zero, the relative deadband does not hide the changes */
+  Sample speed("speed");
+  speed.setRelativeDeadband(10.0);
+  CHECK(speed.setValue(0.0));
+  sent(speed);
+  CHECK(speed.setValue(0.01));
+}
+
+static void testPathPosition()
+{
+  PathPosition path("path");
+  path.setDeadband(0.5);
+  CHECK(path.setValue(0.0, 0.0, 0.0));
+  sent(path);
+  CHECK(!path.setValue(0.4, 0.4, -0.4));
+  CHECK(path.setValue(0.6, 0.0, 0.0));
+  sent(path);
+
+  /* Out of the deadband of a coordinate, but not far enough */
+  path.setDistanceDeadband(1.0);
+  CHECK(!path.setValue(1.3, 0.6, 0.0));
+  CHECK(path.setValue(1.4, 0.7, 0.0));
+  CHECK(path.getX() == 1.4);
+}
+
+/* The suppressed values are counted in the statistics of the cycles */
+static void testSuppressedCount()
+{
+  AdapterCore core(0);
+  Sample position("Xact");
+  PathPosition path("path");
+  position.setDeadband(1.0);
+  path.setDeadband(1.0);
+  core.addDatum(position);
+  core.addDatum(path);
+
+  core.start();
+  position.setValue(0.0);
+  path.setValue(0.0, 0.0, 0.0);
+  core.finish();
+
+  core.start();
+  position.setValue(0.5);
+  position.setValue(0.0);  /* Same as the sent value: not a suppressed change */
+  path.setValue(0.5, 0.0, 0.0);
+  core.finish();
+
+  core.start();
+  position.setValue(0.7);
+  position.setValue(2.0);
+  core.finish();
+
+  CHECK_EQUAL(3, (int) core.getStats()->mSuppressedChanges.load());
+}
+
+/* Run cycles until the server counts aCount clients */
+static bool waitForClients(AdapterCore &aCore, int aCount)
+{
+  for (int i = 0; i < 200; i++) {
+    aCore.start();
+    aCore.finish();
+    if (aCore.server()->numClients() == aCount)
+      return true;
+    sleepMs(5);
+  }
+  return false;
+}
+
+/* Run cycles every 10 ms for aDuration ms, the value changes at each cycle
+ * if aChange is set */
+static void runCycles(AdapterCore &aCore, Sample &aValue, int aDuration,
+                      bool aChange, int &aNext)
+{
+  for (int elapsed = 0; elapsed < aDuration; elapsed += 10) {
+    aCore.start();
+    if (aChange)
+      aValue.setValue(aNext++);
+    aCore.finish();
+    sleepMs(10);
+  }
+}
+
+/* The changes of a value are sent at most every 100 ms, and the last
+ * change is not lost */
+static void testMinInterval()
+{
+  AdapterCore core(0);
+  Sample position("Xact");
+  position.setMinInterval(100);
+  core.addDatum(position);
+  core.start();
+  core.finish();
+
+  TestClient client(core.getPort());
+  CHECK(waitForClients(core, 1));
+  core.start();
+  core.finish();
+
+  int next = 1;
+  runCycles(core, position, 300, true, next);
+  /* About 30 changes, 3 or 4 sent */
+  int lines = client.countLines("|Xact|");
+  CHECK(lines >= 2 && lines <= 6);
+
+  runCycles(core, position, 200, false, next);
+  char last[32];
+  sprintf(last, "|Xact|%d\n", next - 1);
+  CHECK(client.waitFor(last));
+}
+
+/* An unchanged value is sent again every 100 ms */
+static void testMaxSilence()
+{
+  AdapterCore core(0);
+  Sample position("Xact");
+  position.setMaxSilence(100);
+  core.addDatum(position);
+  core.start();
+  core.finish();
+
+  TestClient client(core.getPort());
+  CHECK(waitForClients(core, 1));
+  core.start();
+  core.finish();
+
+  int next = 7;
+  runCycles(core, position, 10, true, next);
+  runCycles(core, position, 350, false, next);
+  sleepMs(20);
+  /* The change, then about 3 resends */
+  int lines = client.countLines("|Xact|7");
+  CHECK(lines >= 3 && lines <= 6);
+}
+
+int main()
+{
+  initTest();
+  testDeadband();
+  testRelativeDeadband();
+  testPathPosition();
+  testSuppressedCount();
+  testMinInterval();
+  testMaxSilence();
+  return testResult("suppression_test");
+}
@@ -0,0 +1,178 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+/*
+ * Minimal support of the behaviour tests of the native core: each test is
+ * a program that returns 0 if all its checks passed.
+ */
+
+#include "internal.hpp"
+#include "logger.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+static int gFailures = 0;
+
+#define CHECK(aCondition) \
+  do { \
+    if (!(aCondition)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #aCondition); \
+      gFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(aExpected, aActual) \
+  do { \
+    long long expected = (long long) (aExpected), actual = (long long) (aActual); \
+    if (expected != actual) { \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+              #aActual, actual, expected); \
+      gFailures++; \
+    } \
+  } while (0)
+
+/* The result of the test program */
+static int testResult(const char *aName)
+{
+  if (gFailures > 0)
+    fprintf(stderr, "%s: %d check(s) failed\n", aName, gFailures);
+  else
+    printf("%s: passed\n", aName);
+  return gFailures > 0 ? 1 : 0;
+}
+
+/* Only log the errors of the tested code */
+static void initTest()
+{
+  if (gLogger == 0)
+    gLogger = new Logger();
+  gLogger->setLogLevel(Logger::eERROR);
+}
+
+static void sleepMs(int aMilliseconds)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(aMilliseconds));
+}
+
+/* A client of the server on the loopback interface */
+class TestClient
+{
+protected:
+  SOCKET mSocket;
+  std::string mReceived;
+
+public:
+  TestClient(int aPort)
+  {
+    mSocket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    SOCKADDR_IN addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(aPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(mSocket, (SOCKADDR *) &addr, sizeof(addr)) != 0) {
+      perror("connect");
+      exit(2);
+    }
+  }
+  ~TestClient() { close(); }
+
+  void close()
+  {
+    if (mSocket != INVALID_SOCKET) {
+      ::closesocket(mSocket);
+      mSocket = INVALID_SOCKET;
+    }
+  }
+
+  void send(const char *aData) { ::send(mSocket, aData, (int) strlen(aData), 0); }
+
+  /* What was received so far, without waiting */
+  const std::string &received()
+  {
+    char buffer[4096];
+    int len;
+    while ((len = ::recv(mSocket, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+      mReceived.append(buffer, len);
+    return mReceived;
+  }
+
+  /* Wait at most aTimeout ms until aText was received */
+  bool waitFor(const char *aText, int aTimeout = 1000)
+  {
+    for (int waited = 0; received().find(aText) == std::string::npos; waited += 5) {
+      if (waited >= aTimeout)
+        return false;
+      sleepMs(5);
+    }
+    return true;
+  }
+
+  /* Number of received lines that contain aText */
+  int countLines(const char *aText)
+  {
+    int count = 0;
+    const std::string &text = received();
+    size_t start = 0, end;
+    while ((end = text.find('\n', start)) != std::string::npos) {
+      if (text.substr(start, end - start).find(aText) != std::string::npos)
+        count++;
+      start = end + 1;
+    }
+    return count;
+  }
+
+  /* Has the server closed the connection ? Waits at most aTimeout ms */
+  bool closedByServer(int aTimeout = 1000)
+  {
+    char buffer[4096];
+    for (int waited = 0; waited < aTimeout; waited += 5) {
+      int len = ::recv(mSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (len == 0)
+        return true;
+      if (len > 0)
+        mReceived.append(buffer, len);
+      else
+        sleepMs(5);
+    }
+    return false;
+  }
+};
+
+#endif
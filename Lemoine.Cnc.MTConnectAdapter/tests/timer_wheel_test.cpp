@@ -0,0 +1,198 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+/*
+ * TimerWheel: the timers expire at their deadline, whatever the turn of
+ * the wheel they are in, and the wheel can be cancelled and rescheduled.
+ * The time is simulated.
+ */
+
+#include "test.hpp"
+#include "timer_wheel.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+
+/* Collect the timers that expired at aNow */
+static std::set<Timer *> expire(TimerWheel &aWheel, unsigned long long aNow)
+{
+  std::set<Timer *> expired;
+  Timer *timer;
+  while ((timer = aWheel.nextExpired(aNow)) != 0) {
+    CHECK(timer->getDeadline() <= aNow);
+    CHECK(!timer->scheduled());
+    expired.insert(timer);
+  }
+  return expired;
+}
+
+/* Timers in the same slot, one or several turns apart */
+static void testWrapAround()
+{
+  TimerWheel wheel;
+  Timer near, nextTurn, farTurn;
+  unsigned long long start = 1000;
+  expire(wheel, start);
+
+  wheel.schedule(&near, start + 5);
+  wheel.schedule(&nextTurn, start + 5 + TIMER_WHEEL_SIZE);
+  wheel.schedule(&farTurn, start + 5 + 10 * TIMER_WHEEL_SIZE);
+  CHECK_EQUAL(3, wheel.size());
+
+  CHECK(expire(wheel, start + 4).empty());
+  std::set<Timer *> expired = expire(wheel, start + 5);
+  CHECK_EQUAL(1, expired.size());
+  CHECK(expired.count(&near) == 1);
+
+  /* The slot is visited again during the next turn */
+  CHECK(expire(wheel, start + 4 + TIMER_WHEEL_SIZE).empty());
+  expired = expire(wheel, start + 5 + TIMER_WHEEL_SIZE);
+  CHECK_EQUAL(1, expired.size());
+  CHECK(expired.count(&nextTurn) == 1);
+
+  /* A jump of several turns at once */
+  CHECK(expire(wheel, start + 4 + 10 * TIMER_WHEEL_SIZE).empty());
+  expired = expire(wheel, start + 20 * TIMER_WHEEL_SIZE);
+  CHECK_EQUAL(1, expired.size());
+  CHECK(expired.count(&farTurn) == 1);
+  CHECK(wheel.empty());
+}
+
+/* The slots wrap from the last one to the first one */
+static void testSlotWrap()
+{
+  TimerWheel wheel;
+  Timer before, after;
+  unsigned long long start = 3 * TIMER_WHEEL_SIZE - 10;
+  expire(wheel, start);
+  wheel.schedule(&before, start + 8);   /* Slot TIMER_WHEEL_SIZE - 2 */
+  wheel.schedule(&after, start + 13);   /* Slot 3 */
+
+  std::set<Timer *> expired = expire(wheel, start + 12);
+  CHECK_EQUAL(1, expired.size());
+  CHECK(expired.count(&before) == 1);
+  expired = expire(wheel, start + 13);
+  CHECK_EQUAL(1, expired.size());
+  CHECK(expired.count(&after) == 1);
+}
+
+static void testCancelAndReschedule()
+{
+  TimerWheel wheel;
+  Timer timer, other;
+  expire(wheel, 100);
+
+  wheel.schedule(&timer, 110);
+  wheel.cancel(&timer);
+  CHECK(!timer.scheduled());
+  CHECK(expire(wheel, 200).empty());
+
+  /* Scheduled again: only the last deadline counts */
+  wheel.schedule(&timer, 210);
+  wheel.schedule(&timer, 250);
+  CHECK_EQUAL(1, wheel.size());
+  CHECK(expire(wheel, 249).empty());
+  CHECK_EQUAL(1, expire(wheel, 250).size());
+
+  /* A deadline that already passed expires at the next call */
+  wheel.schedule(&timer, 10);
+  CHECK_EQUAL(1, expire(wheel, 250).size());
+
+  /* A timer that is destroyed leaves the wheel */
+  {
+    Timer temporary;
+    wheel.schedule(&temporary, 300);
+    wheel.schedule(&other, 300);
+    CHECK_EQUAL(2, wheel.size());
+  }
+  CHECK_EQUAL(1, wheel.size());
+  std::set<Timer *> expired = expire(wheel, 300);
+  CHECK_EQUAL(1, expired.size());
+  CHECK(expired.count(&other) == 1);
+}
+
+/* Random deadlines, compared with a sorted reference */
+static void testRandom()
+{
+  const int count = 200;
+  TimerWheel wheel;
+  std::vector<Timer> timers(count);
+  std::map<Timer *, unsigned long long> reference;
+  unsigned long long now = 5;
+  unsigned int seed = 12345;
+  expire(wheel, now);
+
+  for (int step = 0; step < 20000; step++) {
+    seed = seed * 1103515245 + 12345;
+    Timer *timer = &timers[(seed >> 8) % count];
+    seed = seed * 1103515245 + 12345;
+    unsigned int delay = (seed >> 8) % (3 * TIMER_WHEEL_SIZE);
+    if (delay % 7 == 0) {
+      wheel.cancel(timer);
+      reference.erase(timer);
+    }
+    else {
+      wheel.schedule(timer, now + delay);
+      reference[timer] = now + delay;
+    }
+
+    seed = seed * 1103515245 + 12345;
+    now += (seed >> 8) % 3;
+    std::set<Timer *> expired = expire(wheel, now);
+    for (std::map<Timer *, unsigned long long>::iterator it = reference.begin();
+         it != reference.end(); ) {
+      bool due = it->second <= now;
+      if (due != (expired.count(it->first) == 1)) {
+        CHECK(due == (expired.count(it->first) == 1));
+        return;
+      }
+      if (due)
+        reference.erase(it++);
+      else
+        ++it;
+    }
+    CHECK_EQUAL(reference.size(), wheel.size());
+  }
+}
+
+int main()
+{
+  initTest();
+  testWrapAround();
+  testSlotWrap();
+  testCancelAndReschedule();
+  testRandom();
+  return testResult("timer_wheel_test");
+}
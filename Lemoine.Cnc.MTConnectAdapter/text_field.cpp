@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "text_field.hpp"
+#include "logger.hpp"
+#include "histogram.hpp"
+
+/* Hash of the empty text */
+static const unsigned int sEmptyHash = 2166136261u;
+
+TextField::TextField()
+{
+  mData = mInline;
+  mData[0] = '\0';
+  mLength = 0;
+  mCapacity = TEXT_FIELD_INLINE_SIZE - 1;
+  mHash = sEmptyHash;
+  mHashed = true;
+}
+
+TextField::~TextField()
+{
+  if (mData != mInline)
+    free(mData);
+}
+
+unsigned int TextField::hash(const char *aText, size_t aLength)
+{
+  unsigned int h = sEmptyHash;
+  for (size_t i = 0; i < aLength; i++)
+  {
+    h ^= (unsigned char) aText[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void TextField::assign(const char *aText, size_t aLength)
+{
+  if (aLength > mCapacity)
+  {
+    /* Round up to a power of two, the block is kept for the next values */
+    size_t size = TEXT_FIELD_INLINE_SIZE * 2;
+    while (size < aLength + 1)
+      size *= 2;
+    char *data = (char *) malloc(size);
+    gProcessStats.mTextAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (data == 0)
+    {
+      if (gLogger != NULL)
+        gLogger->error("Failed to allocate %d bytes for a text value", (int) size);
+      exit(1);
+    }
+    if (mData != mInline)
+      free(mData);
+    mData = data;
+    mCapacity = (unsigned int) (size - 1);
+  }
+
+  memmove(mData, aText, aLength);
+  mData[aLength] = '\0';
+  mLength = (unsigned int) aLength;
+  mHashed = false;
+}
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef TEXT_FIELD_HPP
+#define TEXT_FIELD_HPP
+
+#include <stddef.h>
+#include <string.h>
+
+/* Texts up to this length, terminating nul included, are kept inline */
+const size_t TEXT_FIELD_INLINE_SIZE = 24;
+
+/*
+ * A variable-length text value of a data value: short texts are stored
+ * inline, longer ones in a heap block that is kept for the next values.
+ *
+ * A new value is compared in a single pass to the current one, and its
+ * length is only measured when it changed. The length is cached, and so
+ * is a hash of the text, computed on first use, for the lookups keyed by
+ * the text. The texts are truncated to aMaxLength characters.
+ */
+class TextField
+{
+protected:
+  char *mData;            /* mInline or the heap block */
+  unsigned int mLength;
+  unsigned int mCapacity; /* Characters that fit in mData, nul excluded */
+  unsigned int mHash;
+  bool mHashed;           /* mHash is up to date */
+  char mInline[TEXT_FIELD_INLINE_SIZE];
+
+private:
+  TextField(const TextField &);
+  TextField &operator=(const TextField &);
+
+public:
+  TextField();
+  ~TextField();
+
+  /* FNV-1a */
+  static unsigned int hash(const char *aText, size_t aLength);
+
+  void assign(const char *aText, size_t aLength);
+
+  /* Returns true if the value changed */
+  bool set(const char *aText, size_t aMaxLength)
+  {
+    /* The current value is nul-terminated and already truncated */
+    if (strncmp(aText, mData, aMaxLength) == 0)
+      return false;
+    assign(aText, strnlen(aText, aMaxLength));
+    return true;
+  }
+
+  const char *c_str() const { return mData; }
+  size_t length() const { return mLength; }
+  unsigned int hash()
+  {
+    if (!mHashed)
+    {
+      mHash = hash(mData, mLength);
+      mHashed = true;
+    }
+    return mHash;
+  }
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "timer_wheel.hpp"
+
+Timer::~Timer()
+{
+  if (mWheel != 0)
+    mWheel->cancel(this);
+}
+
+void Timer::link(Timer *aHead)
+{
+  mPrev = aHead->mPrev;
+  mNext = aHead;
+  aHead->mPrev->mNext = this;
+  aHead->mPrev = this;
+}
+
+void Timer::unlink()
+{
+  if (mNext != 0)
+  {
+    mNext->mPrev = mPrev;
+    mPrev->mNext = mNext;
+    mNext = mPrev = 0;
+  }
+}
+
+TimerWheel::TimerWheel()
+  : mCurrent(0), mCount(0)
+{
+  for (int i = 0; i < TIMER_WHEEL_SIZE; i++)
+    mSlots[i].mNext = mSlots[i].mPrev = &mSlots[i];
+  mExpired.mNext = mExpired.mPrev = &mExpired;
+}
+
+TimerWheel::~TimerWheel()
+{
+  /* Leave the timers unscheduled, for their owners */
+  for (int i = 0; i < TIMER_WHEEL_SIZE; i++)
+  {
+    while (mSlots[i].mNext != &mSlots[i])
+      cancel(mSlots[i].mNext);
+    mSlots[i].mNext = mSlots[i].mPrev = 0;
+  }
+  while (mExpired.mNext != &mExpired)
+    cancel(mExpired.mNext);
+  mExpired.mNext = mExpired.mPrev = 0;
+}
+
+void TimerWheel::schedule(Timer *aTimer, unsigned long long aDeadline)
+{
+  if (aTimer->mWheel != 0)
+    aTimer->mWheel->cancel(aTimer);
+  aTimer->mWheel = this;
+  aTimer->mDeadline = aDeadline;
+  mCount++;
+
+  /* A deadline that already passed is taken at the next visit */
+  aTimer->link(slot(aDeadline < mCurrent ? mCurrent : aDeadline));
+}
+
+void TimerWheel::cancel(Timer *aTimer)
+{
+  if (aTimer->mWheel == this)
+  {
+    aTimer->unlink();
+    aTimer->mWheel = 0;
+    mCount--;
+  }
+}
+
+/* Move the timers of a slot that are due to the expired list */
+void TimerWheel::expire(Timer *aSlot, unsigned long long aNow)
+{
+  Timer *timer = aSlot->mNext;
+  while (timer != aSlot)
+  {
+    Timer *next = timer->mNext;
+    if (timer->mDeadline <= aNow)
+    {
+      timer->unlink();
+      timer->link(&mExpired);
+    }
+    timer = next;
+  }
+}
+
+Timer *TimerWheel::nextExpired(unsigned long long aNow)
+{
+  if (mExpired.mNext == &mExpired && mCount > 0 && aNow >= mCurrent)
+  {
+    if (aNow - mCurrent >= (unsigned long long) TIMER_WHEEL_SIZE)
+    {
+      for (int i = 0; i < TIMER_WHEEL_SIZE; i++)
+        expire(&mSlots[i], aNow);
+    }
+    else
+    {
+      for (unsigned long long t = mCurrent; t <= aNow; t++)
+        expire(slot(t), aNow);
+    }
+    /* The slot of aNow is visited again: timers may be scheduled in it
+     * before the end of the millisecond */
+    mCurrent = aNow;
+  }
+
+  Timer *timer = mExpired.mNext;
+  if (timer == &mExpired)
+    return 0;
+  timer->unlink();
+  timer->mWheel = 0;
+  mCount--;
+  return timer;
+}
@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <stddef.h>
+
+class TimerWheel;
+
+/* Some constants */
+const int TIMER_WHEEL_SIZE = 512;  /* Number of slots, of 1 ms each */
+
+/*
+ * A deadline in a timer wheel, embedded in the object it is for.
+ *
+ * A timer is in one wheel at most, and leaves it when it is destroyed.
+ */
+class Timer
+{
+protected:
+  Timer *mNext;
+  Timer *mPrev;
+  TimerWheel *mWheel;   /* The wheel it is scheduled in, 0 if none */
+  unsigned long long mDeadline;
+  void *mOwner;
+
+  friend class TimerWheel;
+
+private:
+  Timer(const Timer &);
+  Timer &operator=(const Timer &);
+
+protected:
+  void link(Timer *aHead);
+  void unlink();
+
+public:
+  Timer(void *aOwner = 0) : mNext(0), mPrev(0), mWheel(0), mDeadline(0), mOwner(aOwner) { }
+  ~Timer();
+
+  void setOwner(void *aOwner) { mOwner = aOwner; }
+  void *getOwner() { return mOwner; }
+  unsigned long long getDeadline() { return mDeadline; }
+  bool scheduled() { return mWheel != 0; }
+};
+
+/*
+ * Hashed timer wheel: the timers are in the slot of their deadline (ms,
+ * modulo the number of slots), so that scheduling, cancelling and
+ * scheduling again are O(1). Getting the expired timers only visits the
+ * slots of the milliseconds that passed since the previous call, at most
+ * all of them once. The timers of a slot that are due in a later turn of
+ * the wheel are left in it.
+ *
+ * The deadlines are given by getMonotonicMilliseconds(). Not thread-safe.
+ */
+class TimerWheel
+{
+protected:
+  Timer mSlots[TIMER_WHEEL_SIZE];  /* Heads of the circular lists */
+  Timer mExpired;                  /* Expired timers that were not returned yet */
+  unsigned long long mCurrent;     /* First millisecond to visit */
+  int mCount;
+
+protected:
+  Timer *slot(unsigned long long aTime) { return &mSlots[aTime & (TIMER_WHEEL_SIZE - 1)]; }
+  void expire(Timer *aSlot, unsigned long long aNow);
+
+public:
+  TimerWheel();
+  ~TimerWheel();
+
+  /* Schedule a timer, or schedule it again */
+  void schedule(Timer *aTimer, unsigned long long aDeadline);
+  void cancel(Timer *aTimer);
+  /* Get the next timer whose deadline is aNow or earlier, and remove it from
+   * the wheel. Returns 0 if there is no more */
+  Timer *nextExpired(unsigned long long aNow);
+
+  bool empty() { return mCount == 0; }
+  int size() { return mCount; }
+};
+
+#endif
@@ -0,0 +1,144 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#include "internal.hpp"
+#include "timestamp.hpp"
+
+/* Position of the sub-second digits in the text */
+const size_t FRACTION_POS = 20;
+
+static inline void put2(char *aText, int aValue)
+{
+  aText[0] = (char) ('0' + aValue / 10);
+  aText[1] = (char) ('0' + aValue % 10);
+}
+
+TimestampFormatter::TimestampFormatter()
+  : mSecond(-1)
+{
+  memcpy(mText, "1970-01-01T00:00:00.000000Z", TIMESTAMP_LEN + 1);
+}
+
+/* Render the date and the time down to the second */
+void TimestampFormatter::renderSecond(long long aSecond)
+{
+  int year, month, day, hour, minute, second;
+#ifdef WIN32
+  /* FILETIME: 100 ns since 1601-01-01 */
+  ULARGE_INTEGER t;
+  t.QuadPart = (ULONGLONG) (aSecond + 11644473600LL) * 10000000ULL;
+  FILETIME ft;
+  ft.dwLowDateTime = t.LowPart;
+  ft.dwHighDateTime = t.HighPart;
+  SYSTEMTIME st;
+  FileTimeToSystemTime(&ft, &st);
+  year = st.wYear; month = st.wMonth; day = st.wDay;
+  hour = st.wHour; minute = st.wMinute; second = st.wSecond;
+#else
+  time_t t = (time_t) aSecond;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  year = tm.tm_year + 1900; month = tm.tm_mon + 1; day = tm.tm_mday;
+  hour = tm.tm_hour; minute = tm.tm_min; second = tm.tm_sec;
+#endif
+
+  put2(mText, (year / 100) % 100);
+  put2(mText + 2, year % 100);
+  put2(mText + 5, month);
+  put2(mText + 8, day);
+  put2(mText + 11, hour);
+  put2(mText + 14, minute);
+  put2(mText + 17, second);
+  mSecond = aSecond;
+}
+
+const char *TimestampFormatter::format(long long aSecond, int aMicrosecond)
+{
+  if (aSecond != mSecond)
+    renderSecond(aSecond);
+
+  char *cp = mText + FRACTION_POS + 5;
+  for (int i = 0; i < 6; i++, cp--)
+  {
+    *cp = (char) ('0' + aMicrosecond % 10);
+    aMicrosecond /= 10;
+  }
+  return mText;
+}
+
+const char *TimestampFormatter::now()
+{
+#ifdef WIN32
+  FILETIME ft;
+  GetSystemTimeAsFileTime(&ft);
+  ULARGE_INTEGER t;
+  t.LowPart = ft.dwLowDateTime;
+  t.HighPart = ft.dwHighDateTime;
+  long long us = (long long) (t.QuadPart / 10) - 11644473600000000LL;
+  return format(us / 1000000, (int) (us % 1000000));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return format((long long) ts.tv_sec, (int) (ts.tv_nsec / 1000));
+#endif
+}
+
+unsigned long long getMonotonicMilliseconds()
+{
+#ifdef WIN32
+  return (unsigned long long) GetTickCount64();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+#endif
+}
+
+unsigned long long getMonotonicNanoseconds()
+{
+#ifdef WIN32
+  static LARGE_INTEGER frequency;
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  unsigned long long f = (unsigned long long) frequency.QuadPart;
+  unsigned long long c = (unsigned long long) counter.QuadPart;
+  return (c / f) * 1000000000ULL + (c % f) * 1000000000ULL / f;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2008, AMT – The Association For Manufacturing Technology (“AMT”)
+* 2009-2023 Lemoine Automation Technologies
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the AMT nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* DISCLAIMER OF WARRANTY. ALL MTCONNECT MATERIALS AND SPECIFICATIONS PROVIDED
+* BY AMT, MTCONNECT OR ANY PARTICIPANT TO YOU OR ANY PARTY ARE PROVIDED "AS IS"
+* AND WITHOUT ANY WARRANTY OF ANY KIND. AMT, MTCONNECT, AND EACH OF THEIR
+* RESPECTIVE MEMBERS, OFFICERS, DIRECTORS, AFFILIATES, SPONSORS, AND AGENTS
+* (COLLECTIVELY, THE "AMT PARTIES") AND PARTICIPANTS MAKE NO REPRESENTATION OR
+* WARRANTY OF ANY KIND WHATSOEVER RELATING TO THESE MATERIALS, INCLUDING, WITHOUT
+* LIMITATION, ANY EXPRESS OR IMPLIED WARRANTY OF NONINFRINGEMENT,
+* MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE. 
+
+* LIMITATION OF LIABILITY. IN NO EVENT SHALL AMT, MTCONNECT, ANY OTHER AMT
+* PARTY, OR ANY PARTICIPANT BE LIABLE FOR THE COST OF PROCURING SUBSTITUTE GOODS
+* OR SERVICES, LOST PROFITS, LOSS OF USE, LOSS OF DATA OR ANY INCIDENTAL,
+* CONSEQUENTIAL, INDIRECT, SPECIAL OR PUNITIVE DAMAGES OR OTHER DIRECT DAMAGES,
+* WHETHER UNDER CONTRACT, TORT, WARRANTY OR OTHERWISE, ARISING IN ANY WAY OUT OF
+* THIS AGREEMENT, USE OR INABILITY TO USE MTCONNECT MATERIALS, WHETHER OR NOT
+* SUCH PARTY HAD ADVANCE NOTICE OF THE POSSIBILITY OF SUCH DAMAGES.
+*/
+
+#ifndef TIMESTAMP_HPP
+#define TIMESTAMP_HPP
+
+#include <stddef.h>
+
+/* Length of a rendered timestamp: 2009-06-15T00:00:00.000000Z */
+const size_t TIMESTAMP_LEN = 27;
+
+/*
+ * Renders the current UTC time as an ISO 8601 timestamp with microseconds.
+ *
+ * The date and the time down to the second are cached: as long as the
+ * second does not change, only the six sub-second digits are rewritten.
+ * An instance is not thread-safe, each thread uses its own one.
+ */
+class TimestampFormatter
+{
+protected:
+  char mText[TIMESTAMP_LEN + 1];
+  long long mSecond;   /* The second the cached prefix is for, -1 if none */
+
+protected:
+  void renderSecond(long long aSecond);
+
+public:
+  TimestampFormatter();
+
+  /* Render the current time. Returns the text */
+  const char *now();
+  /* Render a time: seconds and microseconds since the epoch */
+  const char *format(long long aSecond, int aMicrosecond);
+
+  const char *text() const { return mText; }
+  size_t length() const { return TIMESTAMP_LEN; }
+};
+
+/* Milliseconds of a monotonic clock, that does not jump when the system time
+ * is adjusted. Only the differences between two values are meaningful */
+unsigned long long getMonotonicMilliseconds();
+/* The same clock in nanoseconds, to measure short durations */
+unsigned long long getMonotonicNanoseconds();
+
+#endif